@@ -830,11 +830,23 @@ namespace chaiscript
           std::vector<std::string> t_usepaths = {},
           const std::vector<Options> &t_opts = {})
         : ChaiScript_Basic(
-            chaiscript::Std_Lib::library(),
+            standard_library(),
             std::make_unique<parser::ChaiScript_Parser<eval::Noop_Tracer, optimizer::Optimizer_Default>>(),
             t_modulepaths, t_usepaths, t_opts)
         {
         }
+
+      /// \returns the standard library as an image, which is built the first time it is
+      ///          needed and shared by every ChaiScript object created afterwards
+      static const Library_ImagePtr &standard_library()
+      {
+        static const Library_ImagePtr image = [](){
+          parser::ChaiScript_Parser<eval::Noop_Tracer, optimizer::Optimizer_Default> parser;
+          return std::make_shared<const Library_Image>(chaiscript::Std_Lib::library(), parser);
+        }();
+
+        return image;
+      }
   };
 }
 
@@ -77,6 +77,10 @@ static_assert(_MSC_FULL_VER >= 190024210, "Visual C++ 2015 Update 3 or later req
 #include <string>
 #include <cmath>
 
+#ifdef CHAISCRIPT_POOL_ALLOCATOR
+#include "dispatchkit/pool_allocator.hpp"
+#endif
+
 namespace chaiscript {
   static const int version_major = 6;
   static const int version_minor = 0;
@@ -89,13 +93,28 @@ namespace chaiscript {
   template<typename B, typename D, typename ...Arg>
   inline std::shared_ptr<B> make_shared(Arg && ... arg)
   {
-#ifdef CHAISCRIPT_USE_STD_MAKE_SHARED
+#if defined(CHAISCRIPT_POOL_ALLOCATOR)
+    return std::allocate_shared<D>(detail::Pool_Allocator<D>(), std::forward<Arg>(arg)...);
+#elif defined(CHAISCRIPT_USE_STD_MAKE_SHARED)
     return std::make_shared<D>(std::forward<Arg>(arg)...);
 #else
     return std::shared_ptr<B>(static_cast<B*>(new D(std::forward<Arg>(arg)...)));
 #endif
   }
 
+  namespace detail {
+    /// std::make_shared, taking the memory from the pool allocator if CHAISCRIPT_POOL_ALLOCATOR is defined
+    template<typename T, typename ...Arg>
+    inline std::shared_ptr<T> allocate_shared(Arg && ... arg)
+    {
+#ifdef CHAISCRIPT_POOL_ALLOCATOR
+      return std::allocate_shared<T>(Pool_Allocator<T>(), std::forward<Arg>(arg)...);
+#else
+      return std::make_shared<T>(std::forward<Arg>(arg)...);
+#endif
+    }
+  }
+
   struct Build_Info {
     static int version_major()
     {
@@ -8,7 +8,10 @@
 #define CHAISCRIPT_THREADING_HPP_
 
 
+#include <algorithm>
+#include <memory>
 #include <unordered_map>
+#include <vector>
 
 #ifndef CHAISCRIPT_NO_THREADS
 #include <thread>
@@ -58,8 +61,9 @@ namespace chaiscript
       using std::recursive_mutex;
 
 #ifdef CHAISCRIPT_HAS_THREAD_LOCAL
-      /// Typesafe thread specific storage. If threading is enabled, this class uses a mutex protected map. If
-      /// threading is not enabled, the class always returns the same data, regardless of which thread it is called from.
+      /// Typesafe thread specific storage. If threading is enabled, each instance is given a small integer id
+      /// which indexes a thread local array of slots. If threading is not enabled, the class always returns
+      /// the same data, regardless of which thread it is called from.
       template<typename T>
         class Thread_Storage
         {
@@ -68,42 +72,139 @@ namespace chaiscript
             explicit Thread_Storage(void *t_key)
               : m_key(t_key)
             {
+              auto &ids = id_pool();
+              lock_guard<mutex> l(ids.m_mutex);
+              if (ids.m_free.empty()) {
+                m_id = ids.m_generations.size();
+                ids.m_generations.push_back(0);
+              } else {
+                m_id = ids.m_free.back();
+                ids.m_free.pop_back();
+              }
+              m_generation = ++ids.m_generations[m_id];
             }
 
+            Thread_Storage(const Thread_Storage &) = delete;
+            Thread_Storage &operator=(const Thread_Storage &) = delete;
+
             ~Thread_Storage()
             {
-              t().erase(m_key);
+              // destroyed once no lock is held, a value's destructor can use thread storage
+              std::vector<std::unique_ptr<T>> values;
+
+              auto &ids = id_pool();
+              lock_guard<mutex> l(ids.m_mutex);
+              for (auto *thread : ids.m_threads) {
+                lock_guard<mutex> l2(thread->m_mutex);
+                if (m_id < thread->m_slots.size() && thread->m_slots[m_id].m_generation == m_generation) {
+                  values.push_back(std::move(thread->m_slots[m_id].m_value));
+                }
+              }
+              ids.m_free.push_back(m_id);
             }
 
             inline const T *operator->() const
             {
-              return &(t()[m_key]);
+              return &get();
             }
 
             inline const T &operator*() const
             {
-              return t()[m_key];
+              return get();
             }
 
             inline T *operator->()
             {
-              return &(t()[m_key]);
+              return &get();
             }
 
             inline T &operator*()
             {
-              return t()[m_key];
+              return get();
             }
 
 
             void *m_key;
 
           private:
-            static std::unordered_map<void*, T> &t()
+            struct Slot
+            {
+              /// generation of the id the value was created for, a reused id starts over with a new value
+              size_t m_generation = 0;
+              std::unique_ptr<T> m_value;
+            };
+
+            struct Thread_Slots;
+
+            struct Id_Pool
+            {
+              mutex m_mutex;
+              std::vector<size_t> m_free;
+              /// the current generation of each id handed out
+              std::vector<size_t> m_generations;
+              /// the slots of each thread that used an instance, for the instance to free its own
+              std::vector<Thread_Slots *> m_threads;
+            };
+
+            /// The slots of one thread, indexed by instance id. Only the thread itself reads them,
+            /// other threads only free the value of an instance being destroyed.
+            struct Thread_Slots
+            {
+              Thread_Slots()
+              {
+                auto &ids = id_pool();
+                lock_guard<mutex> l(ids.m_mutex);
+                ids.m_threads.push_back(this);
+              }
+
+              ~Thread_Slots()
+              {
+                auto &ids = id_pool();
+                lock_guard<mutex> l(ids.m_mutex);
+                ids.m_threads.erase(std::find(ids.m_threads.begin(), ids.m_threads.end(), this));
+              }
+
+              Thread_Slots(const Thread_Slots &) = delete;
+              Thread_Slots &operator=(const Thread_Slots &) = delete;
+
+              /// held while m_slots changes, other than by reading the value of a slot
+              mutex m_mutex;
+              std::vector<Slot> m_slots;
+            };
+
+            T &get() const
             {
-              thread_local static std::unordered_map<void *, T> my_t;
+              auto &thread = t();
+              if (m_id >= thread.m_slots.size()) {
+                lock_guard<mutex> l(thread.m_mutex);
+                thread.m_slots.resize(m_id + 1);
+              }
+
+              auto &slot = thread.m_slots[m_id];
+              if (slot.m_generation != m_generation || !slot.m_value) {
+                // a value left over from an earlier owner of the id is destroyed unlocked
+                std::unique_ptr<T> value(new T());
+                lock_guard<mutex> l(thread.m_mutex);
+                slot.m_value.swap(value);
+                slot.m_generation = m_generation;
+              }
+              return *slot.m_value;
+            }
+
+            static Thread_Slots &t()
+            {
+              thread_local static Thread_Slots my_t;
               return my_t;
             }
+
+            static Id_Pool &id_pool()
+            {
+              static Id_Pool ids;
+              return ids;
+            }
+
+            size_t m_id;
+            size_t m_generation;
         };
 
 #else
@@ -246,7 +246,7 @@ namespace chaiscript
 
       /// Create a bound function object. The first param is the function to bind
       /// the remaining parameters are the args to bind into the result
-      static Boxed_Value bind_function(const std::vector<Boxed_Value> &params)
+      static Boxed_Value bind_function(const Function_Params &params)
       {
         if (params.empty()) {
           throw exception::arity_error(0, 1);
@@ -263,6 +263,11 @@ namespace chaiscript
           std::vector<Boxed_Value>(params.begin() + 1, params.end()))));
       }
 
+      static Boxed_Value bind_function(const std::vector<Boxed_Value> &params)
+      {
+        return bind_function(Function_Params(params));
+      }
+
 
       static bool has_guard(const Const_Proxy_Function &t_pf)
       {
@@ -502,7 +507,7 @@ namespace chaiscript
         m.add(fun(&print), "print_string");
         m.add(fun(&println), "println_string");
 
-        m.add(dispatch::make_dynamic_proxy_function(&bind_function), "bind");
+        m.add(dispatch::make_dynamic_proxy_function(static_cast<Boxed_Value (*)(const Function_Params &)>(&bind_function)), "bind");
 
         m.add(fun(&shared_ptr_unconst_clone<dispatch::Proxy_Function_Base>), "clone");
         m.add(fun(&ptr_assign<std::remove_const<dispatch::Proxy_Function_Base>::type>), "=");
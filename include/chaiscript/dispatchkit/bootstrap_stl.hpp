@@ -96,6 +96,19 @@ namespace chaiscript
 
       namespace detail {
 
+        /// Native iteration for ranged for loops, elements are passed the same way
+        /// Bidir_Range::front returns them
+        template<typename ContainerType>
+          void iterate(ContainerType &t_container, const Iteration_Body &t_body)
+          {
+            for (auto &&elem : t_container)
+            {
+              if (t_body(dispatch::detail::Handle_Return<decltype(elem)>::handle(elem))) {
+                return;
+              }
+            }
+          }
+
         template<typename T>
         size_t count(const T &t_target, const typename T::key_type &t_key)
         {
@@ -173,6 +186,9 @@ namespace chaiscript
         {
           detail::input_range_type_impl<Bidir_Range<ContainerType, typename ContainerType::iterator> >(type,m);
           detail::input_range_type_impl<Bidir_Range<const ContainerType, typename ContainerType::const_iterator> >("Const_" + type,m);
+
+          m.add(Native_Iteration(fun(&detail::iterate<ContainerType>)));
+          m.add(Native_Iteration(fun(&detail::iterate<const ContainerType>)));
         }
       template<typename ContainerType>
         ModulePtr input_range_type(const std::string &type)
@@ -101,6 +101,20 @@ namespace chaiscript
 
   }
 
+  /// \brief Checks, without throwing, whether boxed_cast<Type> could succeed for bv
+  /// \returns false if boxed_cast<Type>(bv, t_conversions) is certain to throw exception::bad_boxed_cast.
+  ///          A cast that can only be decided by trying it, such as a dynamic down cast, is reported as possible
+  template<typename Type>
+  bool can_boxed_cast(const Boxed_Value &bv, const Type_Conversions_State *t_conversions = nullptr)
+  {
+    if (detail::Cast_Check<Type>::possible(bv)) {
+      return true;
+    }
+
+    return t_conversions && (*t_conversions)->convertable_type<Type>()
+      && (*t_conversions)->converts(user_type<Type>(), bv.get_type_info());
+  }
+
 }
 
 
@@ -174,7 +174,7 @@ namespace chaiscript
       {
         static auto cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          return ob.get().cast<std::shared_ptr<Result> >();
+          return ob.get_shared_ptr<Result>();
         }
       };
 
@@ -186,9 +186,9 @@ namespace chaiscript
         {
           if (!ob.get_type_info().is_const())
           {
-            return std::const_pointer_cast<const Result>(ob.get().cast<std::shared_ptr<Result> >());
+            return std::const_pointer_cast<const Result>(ob.get_shared_ptr<Result>());
           } else {
-            return ob.get().cast<std::shared_ptr<const Result> >();
+            return ob.get_shared_ptr<const Result>();
           }
         }
       };
@@ -210,8 +210,7 @@ namespace chaiscript
         static_assert(!std::is_const<Result>::value, "Non-const reference to std::shared_ptr<const T> is not supported");
         static auto cast(const Boxed_Value &ob, const Type_Conversions_State *)
         {
-          std::shared_ptr<Result> &res = ob.get().cast<std::shared_ptr<Result> >();
-          return ob.pointer_sentinel(res);
+          return ob.pointer_sentinel<Result>();
         }
       };
 
@@ -301,6 +300,107 @@ namespace chaiscript
           return(Cast_Helper_Inner<T>::cast(ob, t_conversions));
         }
       };
+
+
+    /// Reports whether Cast_Helper<T> could accept ob as it is, without throwing. It can report
+    /// a cast that later fails as possible, but never rejects one that would succeed
+    template<typename T>
+      struct Cast_Check
+      {
+        static bool possible(const Boxed_Value &ob) noexcept
+        {
+          return ob.get_type_info().bare_equal(user_type<T>());
+        }
+      };
+
+    template<typename T>
+      struct Cast_Check<const T> : Cast_Check<T>
+      {
+      };
+
+    /// casts to a non-const reference or pointer need a non-const object
+    template<typename T>
+      struct Cast_Check_Mutable
+      {
+        static bool possible(const Boxed_Value &ob) noexcept
+        {
+          return !ob.is_const() && Cast_Check<T>::possible(ob);
+        }
+      };
+
+    template<typename T>
+      struct Cast_Check<T &> : std::conditional<std::is_const<T>::value, Cast_Check<T>, Cast_Check_Mutable<T>>::type
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<T &&> : Cast_Check_Mutable<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<T *> : std::conditional<std::is_const<T>::value, Cast_Check<T>, Cast_Check_Mutable<T>>::type
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<T * const &> : Cast_Check<T *>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<std::shared_ptr<T>> : Cast_Check<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<std::shared_ptr<T> &> : Cast_Check<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<const std::shared_ptr<T> &> : Cast_Check<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<std::unique_ptr<T> &> : Cast_Check<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<std::unique_ptr<T> &&> : Cast_Check<T>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<std::reference_wrapper<T>> : Cast_Check<T &>
+      {
+      };
+
+    template<typename T>
+      struct Cast_Check<const std::reference_wrapper<T> &> : Cast_Check<T &>
+      {
+      };
+
+    template<>
+      struct Cast_Check<Boxed_Value>
+      {
+        static bool possible(const Boxed_Value &) noexcept
+        {
+          return true;
+        }
+      };
+
+    template<>
+      struct Cast_Check<Boxed_Value &> : Cast_Check<Boxed_Value>
+      {
+      };
+
+    template<>
+      struct Cast_Check<const Boxed_Value &> : Cast_Check<Boxed_Value>
+      {
+      };
   }
   
 }
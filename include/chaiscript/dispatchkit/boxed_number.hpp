@@ -832,6 +832,14 @@ namespace chaiscript
         return oper(t_oper, t_lhs);
       }
 
+      /// do_oper for operands that are both known to hold a T, skips looking up their types
+      template<typename T>
+      static Boxed_Value do_oper_as(Operators::Opers t_oper, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs)
+      {
+        assert(t_lhs.get_type_info().bare_equal_type_info(typeid(T)) && t_rhs.get_type_info().bare_equal_type_info(typeid(T)));
+        return go<T, T>(t_oper, t_lhs, t_rhs);
+      }
+
 
 
       Boxed_Value bv;
@@ -860,6 +868,20 @@ namespace chaiscript
       struct Cast_Helper<const Boxed_Number> : Cast_Helper<Boxed_Number>
       {
       };
+
+    template<>
+      struct Cast_Check<Boxed_Number>
+      {
+        static bool possible(const Boxed_Value &ob) noexcept
+        {
+          return ob.get_type_info().is_arithmetic();
+        }
+      };
+
+    template<>
+      struct Cast_Check<const Boxed_Number &> : Cast_Check<Boxed_Number>
+      {
+      };
   }
 
 #ifdef __GNUC__
@@ -9,6 +9,7 @@
 
 #include <map>
 #include <memory>
+#include <string>
 #include <type_traits>
 
 #include "../chaiscript_defines.hpp"
@@ -17,6 +18,23 @@
 
 namespace chaiscript 
 {
+  namespace detail
+  {
+    /// Values of these types are stored in the same allocation as the Boxed_Value's internal
+    /// data instead of in a std::shared_ptr of their own
+    template<typename T>
+      struct Stored_Inline : std::integral_constant<bool,
+          std::is_arithmetic<T>::value || std::is_enum<T>::value || std::is_same<T, std::string>::value>
+      {
+      };
+
+    /// A value to be boxed as an immutable object, see chaiscript::const_var
+    template<typename T>
+      struct Const_Value
+      {
+        T value;
+      };
+  }
 
   /// \brief A wrapper for holding any valid C++ type. All types in ChaiScript are Boxed_Value objects
   /// \sa chaiscript::boxed_cast
@@ -30,7 +48,6 @@ namespace chaiscript
 
     private:
       /// structure which holds the internal state of a Boxed_Value
-      /// \todo Get rid of Any and merge it with this, reducing an allocation in the process
       struct Data
       {
         Data(const Type_Info &ti,
@@ -51,6 +68,8 @@ namespace chaiscript
           m_data_ptr = rhs.m_data_ptr;
           m_const_data_ptr = rhs.m_const_data_ptr;
           m_return_value = rhs.m_return_value;
+          // the pointers refer to the value of rhs now, see Boxed_Value::assign
+          m_inline = false;
 
           if (rhs.m_attrs)
           {
@@ -62,8 +81,9 @@ namespace chaiscript
 
         Data(const Data &) = delete;
 
-        Data(Data &&) = default;
-        Data &operator=(Data &&rhs) = default;
+        // the data pointers of an Inline_Data refer to the object itself
+        Data(Data &&) = delete;
+        Data &operator=(Data &&rhs) = delete;
 
 
         Type_Info m_type_info;
@@ -73,13 +93,32 @@ namespace chaiscript
         std::unique_ptr<std::map<std::string, std::shared_ptr<Data>>> m_attrs;
         bool m_is_ref;
         bool m_return_value;
+        /// the value is held by this Data itself, see Inline_Data
+        bool m_inline = false;
       };
 
+      /// Data and the value it holds in one allocation. m_obj is left empty, a std::shared_ptr
+      /// to the value shares ownership of the Data
+      template<typename T>
+        struct Inline_Data : Data
+        {
+          Inline_Data(const Type_Info &ti, T t, bool t_return_value)
+            : Data(ti, chaiscript::detail::Any(), false, nullptr, t_return_value),
+              m_value(std::move(t))
+          {
+            m_data_ptr = ti.is_const()?nullptr:&m_value;
+            m_const_data_ptr = &m_value;
+            m_inline = true;
+          }
+
+          T m_value;
+        };
+
       struct Object_Data
       {
         static auto get(Boxed_Value::Void_Type, bool t_return_value)
         {
-          return std::make_shared<Data>(
+          return chaiscript::detail::allocate_shared<Data>(
                 detail::Get_Type_Info<void>::get(),
                 chaiscript::detail::Any(), 
                 false,
@@ -97,7 +136,7 @@ namespace chaiscript
         template<typename T>
           static auto get(const std::shared_ptr<T> &obj, bool t_return_value)
           {
-            return std::make_shared<Data>(
+            return chaiscript::detail::allocate_shared<Data>(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(obj), 
                   false,
@@ -110,7 +149,7 @@ namespace chaiscript
           static auto get(std::shared_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return chaiscript::detail::allocate_shared<Data>(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(obj)), 
                   false,
@@ -138,7 +177,7 @@ namespace chaiscript
           static auto get(std::reference_wrapper<T> obj, bool t_return_value)
           {
             auto p = &obj.get();
-            return std::make_shared<Data>(
+            return chaiscript::detail::allocate_shared<Data>(
                   detail::Get_Type_Info<T>::get(),
                   chaiscript::detail::Any(std::move(obj)),
                   true,
@@ -151,7 +190,7 @@ namespace chaiscript
           static auto get(std::unique_ptr<T> &&obj, bool t_return_value)
           {
             auto ptr = obj.get();
-            return std::make_shared<Data>(
+            return chaiscript::detail::allocate_shared<Data>(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::make_shared<std::unique_ptr<T>>(std::move(obj))), 
                   false,
@@ -163,9 +202,33 @@ namespace chaiscript
         template<typename T>
           static auto get(T t, bool t_return_value)
           {
-            auto p = std::make_shared<T>(std::move(t));
+            return get_value(std::move(t), t_return_value, detail::Stored_Inline<T>());
+          }
+
+        template<typename T>
+          static auto get(detail::Const_Value<T> t, bool t_return_value)
+          {
+            return get_inline(detail::Get_Type_Info<const T>::get(), std::move(t.value), t_return_value);
+          }
+
+        template<typename T>
+          static std::shared_ptr<Data> get_inline(const Type_Info &ti, T t, bool t_return_value)
+          {
+            return chaiscript::detail::allocate_shared<Inline_Data<T>>(ti, std::move(t), t_return_value);
+          }
+
+        template<typename T>
+          static auto get_value(T t, bool t_return_value, std::true_type)
+          {
+            return get_inline(detail::Get_Type_Info<T>::get(), std::move(t), t_return_value);
+          }
+
+        template<typename T>
+          static auto get_value(T t, bool t_return_value, std::false_type)
+          {
+            auto p = chaiscript::detail::allocate_shared<T>(std::move(t));
             auto ptr = p.get();
-            return std::make_shared<Data>(
+            return chaiscript::detail::allocate_shared<Data>(
                   detail::Get_Type_Info<T>::get(), 
                   chaiscript::detail::Any(std::move(p)),
                   false,
@@ -176,7 +239,7 @@ namespace chaiscript
 
         static std::shared_ptr<Data> get()
         {
-          return std::make_shared<Data>(
+          return chaiscript::detail::allocate_shared<Data>(
                 Type_Info(),
                 chaiscript::detail::Any(),
                 false,
@@ -213,7 +276,21 @@ namespace chaiscript
       /// m_data pointers are not shared in this case
       Boxed_Value assign(const Boxed_Value &rhs)
       {
+        if (m_data == rhs.m_data) {
+          return *this;
+        }
+
         (*m_data) = (*rhs.m_data);
+
+        // a value stored inline stays in the Data holding it, which has to outlive this one
+        if (rhs.m_data->m_inline) {
+          m_data->m_obj = chaiscript::detail::Any(rhs.m_data);
+        } else if (m_data->m_obj.type() == typeid(std::shared_ptr<Data>)
+            && m_data->m_obj.cast<std::shared_ptr<Data>>() == m_data) {
+          // assigned back the value this holds itself
+          m_data->m_obj = chaiscript::detail::Any();
+          m_data->m_inline = true;
+        }
         return *this;
       }
 
@@ -239,39 +316,66 @@ namespace chaiscript
       }
 
 
+      /// \returns an object that converts to a std::shared_ptr<T>& and updates this Boxed_Value
+      ///          with whatever the std::shared_ptr points to when it is destroyed
       template<typename T>
-      auto pointer_sentinel(std::shared_ptr<T> &ptr) const
+      auto pointer_sentinel() const
       {
         struct Sentinel {
-          Sentinel(std::shared_ptr<T> &t_ptr, Data &data)
-            : m_ptr(t_ptr), m_data(data)
+          Sentinel(std::shared_ptr<T> *t_ptr, std::shared_ptr<T> t_inline, Data &data)
+            : m_ptr(t_ptr), m_inline(std::move(t_inline)), m_data(&data)
           {
           }
 
           ~Sentinel()
           {
+            if (!m_data) {
+              return;
+            }
+
             // save new pointer data
-            const auto ptr = m_ptr.get().get();
-            m_data.get().m_data_ptr = ptr;
-            m_data.get().m_const_data_ptr = ptr;
+            if (m_ptr) {
+              const auto ptr = m_ptr->get();
+              m_data->m_data_ptr = ptr;
+              m_data->m_const_data_ptr = ptr;
+            } else if (m_inline.get() != m_data->m_const_data_ptr) {
+              // a different object was assigned, which cannot be stored inline
+              const auto ptr = m_inline.get();
+              m_data->m_obj = chaiscript::detail::Any(std::move(m_inline));
+              m_data->m_inline = false;
+              m_data->m_data_ptr = ptr;
+              m_data->m_const_data_ptr = ptr;
+            }
           }
 
-          Sentinel& operator=(Sentinel&&s) = default;
-          Sentinel(Sentinel &&s) = default;
+          Sentinel(Sentinel &&s) noexcept
+            : m_ptr(s.m_ptr), m_inline(std::move(s.m_inline)), m_data(s.m_data)
+          {
+            s.m_data = nullptr;
+          }
 
           operator std::shared_ptr<T>&() const
           {
-            return m_ptr.get();
+            return m_ptr?*m_ptr:m_inline;
           }
 
+          Sentinel& operator=(Sentinel&&s) = delete;
           Sentinel &operator=(const Sentinel &) = delete;
           Sentinel(Sentinel&) = delete;
 
-          std::reference_wrapper<std::shared_ptr<T>> m_ptr;
-          std::reference_wrapper<Data> m_data;
+          /// the std::shared_ptr stored in m_obj, or null if the value is stored inline
+          std::shared_ptr<T> *m_ptr;
+          /// shares the inline value if there is no stored std::shared_ptr
+          mutable std::shared_ptr<T> m_inline;
+          Data *m_data;
         };
 
-        return Sentinel(ptr, *(m_data.get()));
+        auto &obj = m_data->m_obj;
+        if (obj.type() == typeid(std::shared_ptr<T>)) {
+          return Sentinel(&obj.cast<std::shared_ptr<T>>(), nullptr, *m_data);
+        } else {
+          return Sentinel(nullptr, get_shared_ptr<T>(), *m_data);
+        }
       }
 
       bool is_null() const noexcept
@@ -284,6 +388,24 @@ namespace chaiscript
         return m_data->m_obj;
       }
 
+      /// \returns the object as a std::shared_ptr<T>. If the value is stored inline the
+      ///          std::shared_ptr shares ownership of the Data holding it
+      /// \throws chaiscript::detail::exception::bad_any_cast if the object is not a T
+      template<typename T>
+        std::shared_ptr<T> get_shared_ptr() const
+        {
+          const auto &obj = m_data->m_obj;
+          if (obj.empty() || obj.type() == typeid(std::shared_ptr<Data>)) {
+            const std::shared_ptr<Data> &owner = obj.empty() ? m_data : obj.cast<std::shared_ptr<Data>>();
+            if (owner->m_inline && m_data->m_type_info.bare_equal_type_info(typeid(T))
+                && (std::is_const<T>::value || !m_data->m_type_info.is_const()))
+            {
+              return std::shared_ptr<T>(owner, static_cast<T *>(const_cast<void *>(m_data->m_const_data_ptr)));
+            }
+          }
+          return obj.cast<std::shared_ptr<T>>();
+        }
+
       bool is_ref() const noexcept
       {
         return m_data->m_is_ref;
@@ -391,11 +513,23 @@ namespace chaiscript
     /// \returns Immutable Boxed_Value 
     /// \sa Boxed_Value::is_const
     template<typename T>
-      Boxed_Value const_var_impl(const T &t)
+      Boxed_Value const_var_value(const T &t, std::true_type)
+      {
+        return Boxed_Value(Const_Value<T>{t});
+      }
+
+    template<typename T>
+      Boxed_Value const_var_value(const T &t, std::false_type)
       {
         return Boxed_Value(std::make_shared<typename std::add_const<T>::type >(t));
       }
 
+    template<typename T>
+      Boxed_Value const_var_impl(const T &t)
+      {
+        return const_var_value(t, Stored_Inline<T>());
+      }
+
     /// \brief Takes a pointer to a value, adds const to the pointed to type and returns an immutable Boxed_Value.
     ///        Does not copy the pointed to value.
     /// \param[in] t Pointer to make immutable
@@ -8,6 +8,8 @@
 #define CHAISCRIPT_DISPATCHKIT_HPP_
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <iostream>
 #include <list>
 #include <map>
@@ -28,6 +30,8 @@
 #include "type_conversions.hpp"
 #include "dynamic_object.hpp"
 #include "proxy_constructors.hpp"
+#include "function_params.hpp"
+#include "name_table.hpp"
 #include "proxy_functions.hpp"
 #include "type_info.hpp"
 #include "short_alloc.hpp"
@@ -140,6 +144,32 @@ namespace chaiscript
   }
 
 
+  /// Called by a Native_Iteration with every element of a container, returns true to stop
+  typedef std::function<bool (const Boxed_Value &)> Iteration_Body;
+
+  /// \brief A function that walks a container with its own iterators, calling an Iteration_Body
+  ///        with each element
+  ///
+  /// Ranged for loops use it instead of calling range, empty, front and pop_front for every
+  /// element. It takes the container and the Iteration_Body and is not visible to scripts.
+  class Native_Iteration
+  {
+    public:
+      explicit Native_Iteration(Proxy_Function t_func)
+        : m_func(std::move(t_func))
+      {
+      }
+
+      const Proxy_Function &function() const
+      {
+        return m_func;
+      }
+
+    private:
+      Proxy_Function m_func;
+  };
+
+
   /// \brief Holds a collection of ChaiScript settings which can be applied to the ChaiScript runtime.
   ///        Used to implement loadable module support.
   class Module
@@ -163,6 +193,12 @@ namespace chaiscript
         return *this;
       }
 
+      Module &add(Native_Iteration t_iteration)
+      {
+        m_iterations.push_back(std::move(t_iteration));
+        return *this;
+      }
+
       Module &add_global_const(Boxed_Value t_bv, std::string t_name)
       {
         if (!t_bv.is_const())
@@ -189,9 +225,31 @@ namespace chaiscript
           apply(m_funcs.begin(), m_funcs.end(), t_engine);
           apply_eval(m_evals.begin(), m_evals.end(), t_eval);
           apply_single(m_conversions.begin(), m_conversions.end(), t_engine);
+          apply_single(m_iterations.begin(), m_iterations.end(), t_engine);
+          apply_globals(m_globals.begin(), m_globals.end(), t_engine);
+        }
+
+      /// Applies the types, functions, native iterations and global constants, leaving out the
+      /// conversions and the ChaiScript to eval
+      template<typename Engine>
+        void apply_native(Engine &t_engine) const
+        {
+          apply(m_typeinfos.begin(), m_typeinfos.end(), t_engine);
+          apply(m_funcs.begin(), m_funcs.end(), t_engine);
+          apply_single(m_iterations.begin(), m_iterations.end(), t_engine);
           apply_globals(m_globals.begin(), m_globals.end(), t_engine);
         }
 
+      const std::vector<std::string> &get_evals() const
+      {
+        return m_evals;
+      }
+
+      const std::vector<Type_Conversion> &get_conversions() const
+      {
+        return m_conversions;
+      }
+
       bool has_function(const Proxy_Function &new_f, const std::string &name)
       {
         return std::any_of(m_funcs.begin(), m_funcs.end(), 
@@ -208,6 +266,7 @@ namespace chaiscript
       std::vector<std::pair<Boxed_Value, std::string>> m_globals;
       std::vector<std::string> m_evals;
       std::vector<Type_Conversion> m_conversions;
+      std::vector<Native_Iteration> m_iterations;
 
       template<typename T, typename InItr>
         static void apply(InItr begin, const InItr end, T &t) 
@@ -267,7 +326,13 @@ namespace chaiscript
     {
       public:
         explicit Dispatch_Function(std::vector<Proxy_Function> t_funcs)
-          : Proxy_Function_Base(build_type_infos(t_funcs), calculate_arity(t_funcs)),
+          : Dispatch_Function(std::make_shared<const std::vector<Proxy_Function>>(std::move(t_funcs)))
+        {
+        }
+
+        /// Shares the overload set t_funcs, which must not be modified afterwards
+        explicit Dispatch_Function(std::shared_ptr<const std::vector<Proxy_Function>> t_funcs)
+          : Proxy_Function_Base(build_type_infos(*t_funcs), calculate_arity(*t_funcs)),
             m_funcs(std::move(t_funcs))
         {
         }
@@ -276,7 +341,7 @@ namespace chaiscript
         {
           try {
             const auto &dispatch_fun = dynamic_cast<const Dispatch_Function &>(rhs);
-            return m_funcs == dispatch_fun.m_funcs;
+            return *m_funcs == *dispatch_fun.m_funcs;
           } catch (const std::bad_cast &) {
             return false;
           }
@@ -284,7 +349,17 @@ namespace chaiscript
 
         std::vector<Const_Proxy_Function> get_contained_functions() const override
         {
-          return std::vector<Const_Proxy_Function>(m_funcs.begin(), m_funcs.end());
+          return std::vector<Const_Proxy_Function>(m_funcs->begin(), m_funcs->end());
+        }
+
+        Boxed_Value call(const Function_Params &params, const Type_Conversions_State &t_conversions, dispatch::Dispatch_Cache &t_cache) const override
+        {
+          const auto arity = get_arity();
+          if (arity >= 0 && size_t(arity) != params.size()) {
+            throw chaiscript::exception::arity_error(static_cast<int>(params.size()), arity);
+          }
+
+          return dispatch::dispatch(m_funcs, params, t_conversions, t_cache);
         }
 
 
@@ -308,20 +383,20 @@ namespace chaiscript
           return arity;
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
-          return std::any_of(std::begin(m_funcs), std::end(m_funcs),
+          return std::any_of(std::begin(*m_funcs), std::end(*m_funcs),
                              [&vals, &t_conversions](const Proxy_Function &f){ return f->call_match(vals, t_conversions); });
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
-          return dispatch::dispatch(m_funcs, params, t_conversions);
+          return dispatch::dispatch(*m_funcs, params, t_conversions);
         }
 
       private:
-        std::vector<Proxy_Function> m_funcs;
+        std::shared_ptr<const std::vector<Proxy_Function>> m_funcs;
 
         static std::vector<Type_Info> build_type_infos(const std::vector<Proxy_Function> &t_funcs)
         {
@@ -374,6 +449,52 @@ namespace chaiscript
 
   namespace detail
   {
+    /// Location of a local variable inside of a function frame, resolved before
+    /// the function is ever called. Only meaningful while the frame that was
+    /// pushed for `owner` is the current one.
+    struct Frame_Slot
+    {
+      const void *owner = nullptr;
+      uint_fast32_t index = 0;
+    };
+
+    /// How a function call fills the slots of its frame. When `params` is not 0,
+    /// `this`, the captures in map order and the parameters other than `this`
+    /// take the first `params` slots and are not added to the frame by name.
+    struct Frame_Layout
+    {
+      uint_fast32_t params = 0;
+    };
+
+    /// A return, break or continue statement that has been evaluated but not
+    /// yet handled by the enclosing function or loop
+    enum class Control_Flow
+    {
+      none,
+      return_value,
+      break_loop,
+      continue_loop
+    };
+
+    /// The overloads registered under one function name
+    struct Function_Registration
+    {
+      std::shared_ptr<std::vector<Proxy_Function>> functions;
+      /// what scripts see when they use the name as a value
+      Proxy_Function function_object;
+      Boxed_Value boxed_function_object;
+    };
+
+    /// Functions and global objects of an engine. A Registry is never modified once
+    /// readers can see it, they each hold on to the snapshot they are reading from.
+    struct Registry
+    {
+      Name_Table<Function_Registration> functions;
+      Name_Table<Boxed_Value> globals;
+      /// the functions of the Native_Iterations added, in the order they were added
+      std::vector<Proxy_Function> iterations;
+    };
+
     struct Stack_Holder
     {
       //template <class T, std::size_t BufSize = sizeof(T)*20000>
@@ -401,10 +522,20 @@ namespace chaiscript
 //        stacks.back().emplace_back(Scope(scope_allocator));
       }
 
-      void push_stack()
+      void push_stack(const void *t_owner = nullptr)
       {
         stacks.emplace_back(1);
 //        stacks.emplace_back(StackData(1, Scope(scope_allocator), stack_data_allocator));
+        frame_owners.push_back(t_owner);
+        frame_bases.push_back(frame_slots.size());
+      }
+
+      void pop_stack()
+      {
+        stacks.pop_back();
+        frame_owners.pop_back();
+        frame_slots.resize(frame_bases.back());
+        frame_bases.pop_back();
       }
 
       void push_call_params()
@@ -425,7 +556,66 @@ namespace chaiscript
       Stacks stacks;
       Call_Params call_params;
 
+      /// the node each entry of stacks was pushed for, used to validate Frame_Slot lookups
+      std::vector<const void *> frame_owners;
+      /// the slots of all frames, a Frame_Slot index is relative to the entry of frame_bases
+      /// for its frame
+      std::vector<Boxed_Value> frame_slots;
+      std::vector<size_t> frame_bases;
+
+      Control_Flow control_flow = Control_Flow::none;
+      /// value of the pending return statement
+      Boxed_Value return_value;
+
       int call_depth = 0;
+
+      /// counts the references bound to a name or passed to a function as a return value, either
+      /// can point into the params saved so far, see Dispatch_Engine::release_function_params
+      size_t references_bound = 0;
+
+      /// the registry snapshot this thread looks functions and globals up in, and the
+      /// engine's registry version it was taken at
+      mutable std::shared_ptr<const Registry> registry;
+      mutable size_t registry_version = 0;
+    };
+
+    class Dispatch_Engine;
+
+    /// An engine and the forks made of it, see Dispatch_Engine::family(). Script functions keep
+    /// the family they were defined in alive, so that it can tell them which of its engines
+    /// still exist.
+    class Engine_Family
+    {
+      public:
+        void join(Dispatch_Engine *t_engine)
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          m_engines.push_back(t_engine);
+        }
+
+        void leave(Dispatch_Engine *t_engine)
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          m_engines.erase(std::remove(m_engines.begin(), m_engines.end(), t_engine), m_engines.end());
+        }
+
+        /// \returns t_preferred if it still exists, otherwise the oldest engine of the family
+        ///          that does, or null if none is left
+        Dispatch_Engine *find(Dispatch_Engine *t_preferred) const
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          if (std::find(m_engines.begin(), m_engines.end(), t_preferred) != m_engines.end()) {
+            return t_preferred;
+          } else if (!m_engines.empty()) {
+            return m_engines.front();
+          } else {
+            return nullptr;
+          }
+        }
+
+      private:
+        mutable chaiscript::detail::threading::shared_mutex m_mutex;
+        std::vector<Dispatch_Engine *> m_engines;
     };
 
     /// Main class for the dispatchkit. Handles management
@@ -438,19 +628,53 @@ namespace chaiscript
         typedef std::vector<std::pair<std::string, Boxed_Value>> Scope;
         typedef Stack_Holder::StackData StackData;
 
+        /// Copies of a State share everything with it, an engine copies the parts it changes
+        /// once it no longer has them to itself. Taking and restoring a State does not copy.
         struct State
         {
-          std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> m_functions;
-          std::vector<std::pair<std::string, Proxy_Function>> m_function_objects;
-          std::vector<std::pair<std::string, Boxed_Value>> m_boxed_functions;
-          std::map<std::string, Boxed_Value> m_global_objects;
-          Type_Name_Map m_types;
+          std::shared_ptr<Registry> m_registry = std::make_shared<Registry>();
+          std::shared_ptr<Type_Name_Map> m_types = std::make_shared<Type_Name_Map>();
         };
 
         explicit Dispatch_Engine(chaiscript::parser::ChaiScript_Parser_Base &parser)
           : m_stack_holder(this),
-            m_parser(parser)
+            m_parser(parser),
+            m_family(std::make_shared<Engine_Family>())
+        {
+          m_conversions.set_engine(this);
+          m_family->join(this);
+        }
+
+        ~Dispatch_Engine()
         {
+          m_family->leave(this);
+        }
+
+        Dispatch_Engine(const Dispatch_Engine &) = delete;
+        Dispatch_Engine &operator=(const Dispatch_Engine &) = delete;
+
+        /// Creates a fork of t_parent, which starts out with the parent's state and conversions
+        /// and shares them until either engine changes them. Script functions of the parent that
+        /// the fork calls are evaluated in the fork, see family(). A global object that is not
+        /// const is cloned the first time the fork uses it, see fork_global(), until then the
+        /// fork sees the parent's changes to it.
+        Dispatch_Engine(const Dispatch_Engine &t_parent, chaiscript::parser::ChaiScript_Parser_Base &parser)
+          : m_conversions(t_parent.m_conversions),
+            m_stack_holder(this),
+            m_parser(parser),
+            m_state(t_parent.get_state()),
+            m_fork_globals(m_state.m_registry->globals),
+            m_family(t_parent.m_family)
+        {
+          m_conversions.set_engine(this);
+          m_family->join(this);
+        }
+
+        /// \returns the same family for an engine and all of its forks, it outlives them
+        ///          for as long as it is held on to
+        const std::shared_ptr<Engine_Family> &family() const
+        {
+          return m_family;
         }
 
         /// \brief casts an object while applying any Dynamic_Conversion available
@@ -473,6 +697,27 @@ namespace chaiscript
           add_function(f, name);
         }
 
+        /// Adds a function, replacing the one it compares equal to if there is one
+        void replace(const Proxy_Function &f, const std::string &name)
+        {
+          add_function(f, name, true);
+        }
+
+        /// Add a new way for ranged for loops to walk a container
+        void add(const Native_Iteration &t_iteration)
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          writable_registry().iterations.push_back(t_iteration.function());
+          publish_registry();
+        }
+
+        /// \returns the functions of the Native_Iterations added, valid until the thread's
+        ///          registry snapshot is refreshed
+        const std::vector<Proxy_Function> &get_native_iterations() const
+        {
+          return registry().iterations;
+        }
+
         /// Set the value of an object, by name. If the object
         /// is not available in the current scope it is created
         void add(Boxed_Value obj, const std::string &name)
@@ -553,27 +798,36 @@ namespace chaiscript
 
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          if (m_state.m_global_objects.find(name) != m_state.m_global_objects.end())
+          auto &globals = writable_registry().globals;
+          if (globals.find(name) != globals.size())
           {
             throw chaiscript::exception::name_conflict_error(name);
           } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            globals.set(name, obj);
+            publish_registry();
           }
         }
 
         /// Adds a new global (non-const) shared object, between all the threads
         Boxed_Value add_global_no_throw(const Boxed_Value &obj, const std::string &name)
         {
-          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr == m_state.m_global_objects.end())
+          size_t pos = 0;
           {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
-            return obj;
-          } else {
-            return itr->second;
+            chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
+            const auto &globals = m_state.m_registry->globals;
+            pos = globals.find(name);
+            if (pos == globals.size())
+            {
+              writable_registry().globals.set(name, obj);
+              publish_registry();
+              return obj;
+            } else if (!is_fork_global(globals, pos)) {
+              return globals[pos].second;
+            }
           }
+
+          return fork_global(pos);
         }
 
 
@@ -582,26 +836,40 @@ namespace chaiscript
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          if (m_state.m_global_objects.find(name) != m_state.m_global_objects.end())
+          auto &globals = writable_registry().globals;
+          if (globals.find(name) != globals.size())
           {
             throw chaiscript::exception::name_conflict_error(name);
           } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            globals.set(name, obj);
+            publish_registry();
           }
         }
 
         /// Updates an existing global shared object or adds a new global shared object if not found
         void set_global(const Boxed_Value &obj, const std::string &name)
         {
-          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr != m_state.m_global_objects.end())
+          size_t pos = 0;
           {
-            itr->second.assign(obj);
-          } else {
-            m_state.m_global_objects.insert(std::make_pair(name, obj));
+            chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
+            const auto &globals = m_state.m_registry->globals;
+            pos = globals.find(name);
+            if (pos == globals.size())
+            {
+              writable_registry().globals.set(name, obj);
+              publish_registry();
+              return;
+            } else if (!is_fork_global(globals, pos)) {
+              // copies of a Boxed_Value share their value, this updates it for every snapshot
+              auto global = globals[pos].second;
+              global.assign(obj);
+              return;
+            }
           }
+
+          // the parent's object is not to change
+          fork_global(pos).assign(obj);
         }
 
         /// Adds a new scope to the stack
@@ -636,21 +904,57 @@ namespace chaiscript
 
 
         /// Pushes a new stack on to the list of stacks
-        static void new_stack(Stack_Holder &t_holder)
+        static void new_stack(Stack_Holder &t_holder, const void *t_owner = nullptr)
         {
           // add a new Stack with 1 element
-          t_holder.push_stack();
+          t_holder.push_stack(t_owner);
         }
 
         static void pop_stack(Stack_Holder &t_holder)
         {
-          t_holder.stacks.pop_back();
+          t_holder.pop_stack();
+        }
+
+        /// Returns the object stored at a pre-resolved slot of the current frame,
+        /// or nullptr if the current frame was not pushed for the slot's owner or
+        /// has not stored the slot yet
+        static Boxed_Value *get_frame_object(const Frame_Slot &t_slot, Stack_Holder &t_holder)
+        {
+          if (t_holder.frame_owners.back() != t_slot.owner) {
+            return nullptr;
+          }
+
+          const auto slot = t_holder.frame_bases.back() + t_slot.index;
+          if (slot >= t_holder.frame_slots.size()) {
+            return nullptr;
+          }
+          return &t_holder.frame_slots[slot];
+        }
+
+        /// Stores an object at a pre-resolved slot of the current frame. Returns false
+        /// if the current frame was not pushed for the slot's owner or the slot is not
+        /// the next one to store, in which case nothing is stored.
+        static bool add_frame_object(Boxed_Value obj, const Frame_Slot &t_slot, Stack_Holder &t_holder)
+        {
+          if (t_holder.frame_owners.back() != t_slot.owner
+              || t_holder.frame_bases.back() + t_slot.index != t_holder.frame_slots.size()) {
+            return false;
+          }
+
+          t_holder.frame_slots.push_back(std::move(obj));
+          return true;
         }
 
         /// Searches the current stack for an object of the given name
         /// includes a special overload for the _ place holder object to
         /// ensure that it is always in scope.
-        Boxed_Value get_object(const std::string &name, std::atomic_uint_fast32_t &t_loc, Stack_Holder &t_holder) const
+        Boxed_Value get_object(const std::string &name, std::atomic_uint_fast32_t &t_loc, Stack_Holder &t_holder)
+        {
+          return get_object(name, t_loc, hash_name(name), t_holder);
+        }
+
+        /// Searches for an object, t_hash is the hash_name() of name
+        Boxed_Value get_object(const std::string &name, std::atomic_uint_fast32_t &t_loc, const size_t t_hash, Stack_Holder &t_holder)
         {
           enum class Loc : uint_fast32_t {
             located    = 0x80000000,
@@ -661,6 +965,23 @@ namespace chaiscript
 
           uint_fast32_t loc = t_loc;
 
+          if ((loc & static_cast<uint_fast32_t>(Loc::is_local)) != 0u) {
+            auto &stack = get_stack_data(t_holder);
+            const auto depth = static_cast<size_t>((loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16);
+            const auto index = static_cast<size_t>(loc & static_cast<uint_fast32_t>(Loc::loc_mask));
+
+            if (depth < stack.size()) {
+              auto &scope = stack[stack.size() - 1 - depth];
+              if (index < scope.size() && scope[index].first == name) {
+                return scope[index].second;
+              }
+            }
+
+            // the node is being evaluated under a different scope shape than
+            // the one the hint was recorded in, search again
+            loc = 0;
+          }
+
           if (loc == 0)
           {
             auto &stack = get_stack_data(t_holder);
@@ -681,23 +1002,22 @@ namespace chaiscript
             }
 
             t_loc = static_cast<uint_fast32_t>(Loc::located);
-          } else if ((loc & static_cast<uint_fast32_t>(Loc::is_local)) != 0u) {
-            auto &stack = get_stack_data(t_holder);
-
-            return stack[stack.size() - 1 - ((loc & static_cast<uint_fast32_t>(Loc::stack_mask)) >> 16)][loc & static_cast<uint_fast32_t>(Loc::loc_mask)].second;
           }
 
           // Is the value we are looking for a global or function?
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          const auto &reg = registry(t_holder);
 
-          const auto itr = m_state.m_global_objects.find(name);
-          if (itr != m_state.m_global_objects.end())
+          const auto global = reg.globals.find(name, t_hash);
+          if (global != reg.globals.size())
           {
-            return itr->second;
+            if (is_fork_global(reg.globals, global)) {
+              return fork_global(global);
+            }
+            return reg.globals[global].second;
           }
 
           // no? is it a function object?
-          auto obj = get_function_object_int(name, loc);
+          auto obj = get_function_object_int(reg, name, loc, t_hash);
           if (obj.first != loc) { t_loc = uint_fast32_t(obj.first); }
 
           return obj.second;
@@ -711,7 +1031,14 @@ namespace chaiscript
 
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          m_state.m_types.insert(std::make_pair(name, ti));
+          if (m_state.m_types.use_count() != 1) {
+            m_state.m_types = std::make_shared<Type_Name_Map>(*m_state.m_types);
+          } else {
+            // pairs with the release of the last other State that shared it
+            std::atomic_thread_fence(std::memory_order_acquire);
+          }
+
+          m_state.m_types->insert(std::make_pair(name, ti));
         }
 
         /// Returns the type info for a named type
@@ -719,9 +1046,9 @@ namespace chaiscript
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          const auto itr = m_state.m_types.find(name);
+          const auto itr = m_state.m_types->find(name);
 
-          if (itr != m_state.m_types.end())
+          if (itr != m_state.m_types->end())
           {
             return itr->second;
           }
@@ -740,7 +1067,7 @@ namespace chaiscript
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          for (const auto & elem : m_state.m_types)
+          for (const auto & elem : *m_state.m_types)
           {
             if (elem.second.bare_equal(ti))
             {
@@ -756,7 +1083,7 @@ namespace chaiscript
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          return std::vector<std::pair<std::string, Type_Info> >(m_state.m_types.begin(), m_state.m_types.end());
+          return std::vector<std::pair<std::string, Type_Info> >(m_state.m_types->begin(), m_state.m_types->end());
         }
 
         std::shared_ptr<std::vector<Proxy_Function>> get_method_missing_functions() const
@@ -774,41 +1101,36 @@ namespace chaiscript
         /// Return a function by name
         std::pair<size_t, std::shared_ptr<std::vector< Proxy_Function>>> get_function(const std::string &t_name, const size_t t_hint) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &funs = get_functions_int();
-
-          auto itr = find_keyed_value(funs, t_name, t_hint);
+          // registry() may refresh the thread's snapshot, the hint must index the registry it came from
+          const auto &reg = registry();
+          return get_function_int(reg, reg.functions.find_hinted(t_name, t_hint));
+        }
 
-          if (itr != funs.end())
-          {
-            return std::make_pair(std::distance(funs.begin(), itr), itr->second);
-          } else {
-            return std::make_pair(size_t(0), std::make_shared<std::vector<Proxy_Function>>());
-          }
+        /// Return a function by name, t_hash is the hash_name() of t_name
+        std::pair<size_t, std::shared_ptr<std::vector< Proxy_Function>>> get_function(const std::string &t_name, const size_t t_hint, const size_t t_hash) const
+        {
+          // registry() may refresh the thread's snapshot, the hint must index the registry it came from
+          const auto &reg = registry();
+          return get_function_int(reg, reg.functions.find_hinted(t_name, t_hint, t_hash));
         }
 
         /// \returns a function object (Boxed_Value wrapper) if it exists
         /// \throws std::range_error if it does not
         Boxed_Value get_function_object(const std::string &t_name) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          return get_function_object_int(t_name, 0).second;
+          return get_function_object_int(registry(), t_name, 0, hash_name(t_name)).second;
         }
 
-        /// \returns a function object (Boxed_Value wrapper) if it exists
+        /// \returns a function object (Boxed_Value wrapper) from t_registry if it exists
         /// \throws std::range_error if it does not
-        /// \warn does not obtain a mutex lock. \sa get_function_object for public version
-        std::pair<size_t, Boxed_Value> get_function_object_int(const std::string &t_name, const size_t t_hint) const
+        static std::pair<size_t, Boxed_Value> get_function_object_int(const Registry &t_registry, const std::string &t_name, const size_t t_hint, const size_t t_hash)
         {
-          const auto &funs = get_boxed_functions_int();
+          const auto &funs = t_registry.functions;
+          const auto pos = funs.find_hinted(t_name, t_hint, t_hash);
 
-          auto itr = find_keyed_value(funs, t_name, t_hint);
-
-          if (itr != funs.end())
+          if (pos != funs.size())
           {
-            return std::make_pair(std::distance(funs.begin(), itr), itr->second);
+            return std::make_pair(pos, funs[pos].second.boxed_function_object);
           } else {
             throw std::range_error("Object not found: " + t_name);
           }
@@ -818,10 +1140,8 @@ namespace chaiscript
         /// Return true if a function exists
         bool function_exists(const std::string &name) const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &functions = get_functions_int();
-          return find_keyed_value(functions, name) != functions.end();
+          const auto &functions = registry().functions;
+          return functions.find(name) != functions.size();
         }
 
         /// \returns All values in the local thread state in the parent scope, or if it doesn't exist,
@@ -878,8 +1198,8 @@ namespace chaiscript
           } 
 
           // add the global values
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-          retval.insert(m_state.m_global_objects.begin(), m_state.m_global_objects.end());
+          const auto &globals = registry().globals;
+          retval.insert(globals.begin(), globals.end());
 
           return retval;
         }
@@ -890,15 +1210,11 @@ namespace chaiscript
         ///
         std::map<std::string, Boxed_Value> get_function_objects() const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-          const auto &funs = get_function_objects_int();
-
           std::map<std::string, Boxed_Value> objs;
 
-          for (const auto & fun : funs)
+          for (const auto & fun : registry().functions)
           {
-            objs.insert(std::make_pair(fun.first, const_var(fun.second)));
+            objs.insert(std::make_pair(fun.first, fun.second.boxed_function_object));
           }
 
           return objs;
@@ -908,15 +1224,11 @@ namespace chaiscript
         /// Get a vector of all registered functions
         std::vector<std::pair<std::string, Proxy_Function > > get_functions() const
         {
-          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
           std::vector<std::pair<std::string, Proxy_Function> > rets;
 
-          const auto &functions = get_functions_int();
-
-          for (const auto & function : functions)
+          for (const auto & function : registry().functions)
           {
-            for (const auto & internal_func : *function.second)
+            for (const auto & internal_func : *function.second.functions)
             {
               rets.emplace_back(function.first, internal_func);
             }
@@ -931,7 +1243,7 @@ namespace chaiscript
           return m_conversions;
         }
 
-        static bool is_attribute_call(const std::vector<Proxy_Function> &t_funs, const std::vector<Boxed_Value> &t_params,
+        static bool is_attribute_call(const std::vector<Proxy_Function> &t_funs, const Function_Params &t_params,
             bool t_has_params, const Type_Conversions_State &t_conversions)
         {
           if (!t_has_params || t_params.empty()) {
@@ -952,18 +1264,17 @@ namespace chaiscript
 #pragma warning(push)
 #pragma warning(disable : 4715)
 #endif
-        Boxed_Value call_member(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params, bool t_has_params,
-                                const Type_Conversions_State &t_conversions)
+        Boxed_Value call_member(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const Function_Params &params, bool t_has_params,
+                                const Type_Conversions_State &t_conversions, dispatch::Dispatch_Cache *t_cache = nullptr)
         {
           uint_fast32_t loc = t_loc;
           const auto funs = get_function(t_name, loc);
           if (funs.first != loc) { t_loc = uint_fast32_t(funs.first); }
 
           const auto do_attribute_call = 
-            [this](int l_num_params, const std::vector<Boxed_Value> &l_params, const std::vector<Proxy_Function> &l_funs, const Type_Conversions_State &l_conversions)->Boxed_Value
+            [this](int l_num_params, const Function_Params &l_params, const std::vector<Proxy_Function> &l_funs, const Type_Conversions_State &l_conversions)->Boxed_Value
             {
-              std::vector<Boxed_Value> attr_params{l_params.begin(), l_params.begin() + l_num_params};
-              Boxed_Value bv = dispatch::dispatch(l_funs, attr_params, l_conversions);
+              Boxed_Value bv = dispatch::dispatch(l_funs, Function_Params{l_params.begin(), l_params.begin() + l_num_params}, l_conversions);
               if (l_num_params < int(l_params.size()) || bv.get_type_info().bare_equal(user_type<dispatch::Proxy_Function_Base>())) {
                 struct This_Foist {
                   This_Foist(Dispatch_Engine &e, const Boxed_Value &t_bv) : m_e(e) {
@@ -983,16 +1294,16 @@ namespace chaiscript
                 try {
                   auto func = boxed_cast<const dispatch::Proxy_Function_Base *>(bv);
                   try {
-                    return (*func)({l_params.begin() + l_num_params, l_params.end()}, l_conversions);
+                    return (*func)(Function_Params{l_params.begin() + l_num_params, l_params.end()}, l_conversions);
                   } catch (const chaiscript::exception::bad_boxed_cast &) {
                   } catch (const chaiscript::exception::arity_error &) {
                   } catch (const chaiscript::exception::guard_error &) {
                   }
-                  throw chaiscript::exception::dispatch_error({l_params.begin() + l_num_params, l_params.end()}, 
+                  throw chaiscript::exception::dispatch_error(std::vector<Boxed_Value>(l_params.begin() + l_num_params, l_params.end()), 
                       std::vector<Const_Proxy_Function>{boxed_cast<Const_Proxy_Function>(bv)});
                 } catch (const chaiscript::exception::bad_boxed_cast &) {
                   // unable to convert bv into a Proxy_Function_Base
-                  throw chaiscript::exception::dispatch_error({l_params.begin() + l_num_params, l_params.end()}, 
+                  throw chaiscript::exception::dispatch_error(std::vector<Boxed_Value>(l_params.begin() + l_num_params, l_params.end()), 
                       std::vector<Const_Proxy_Function>(l_funs.begin(), l_funs.end()));
                 }
               } else {
@@ -1007,7 +1318,11 @@ namespace chaiscript
 
             if (!funs.second->empty()) {
               try {
-                return dispatch::dispatch(*funs.second, params, t_conversions);
+                if (t_cache) {
+                  return dispatch::dispatch(funs.second, params, t_conversions, *t_cache);
+                } else {
+                  return dispatch::dispatch(*funs.second, params, t_conversions);
+                }
               } catch(chaiscript::exception::dispatch_error&) {
                 except = std::current_exception();
               }
@@ -1045,14 +1360,15 @@ namespace chaiscript
             if (!functions.empty()) {
               try {
                 if (is_no_param) {
-                  std::vector<Boxed_Value> tmp_params(params);
+                  auto tmp_params = params.to_vector();
                   tmp_params.insert(tmp_params.begin() + 1, var(t_name));
-                  return do_attribute_call(2, tmp_params, functions, t_conversions);
+                  return do_attribute_call(2, Function_Params(tmp_params), functions, t_conversions);
                 } else {
-                  return dispatch::dispatch(functions, {params[0], var(t_name), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}, t_conversions);
+                  const std::array<Boxed_Value, 3> mm_params{{params[0], var(t_name), var(std::vector<Boxed_Value>(params.begin()+1, params.end()))}};
+                  return dispatch::dispatch(functions, mm_params, t_conversions);
                 }
               } catch (const dispatch::option_explicit_set &e) {
-                throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()), 
+                throw chaiscript::exception::dispatch_error(params.to_vector(), std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()), 
                     e.what());
               }
             }
@@ -1062,7 +1378,7 @@ namespace chaiscript
             if (except) {
               std::rethrow_exception(except);
             } else {
-              throw chaiscript::exception::dispatch_error(params, std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()));
+              throw chaiscript::exception::dispatch_error(params.to_vector(), std::vector<Const_Proxy_Function>(funs.second->begin(), funs.second->end()));
             }
           }
         }
@@ -1072,13 +1388,16 @@ namespace chaiscript
 
 
 
-        Boxed_Value call_function(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const std::vector<Boxed_Value> &params,
-            const Type_Conversions_State &t_conversions) const
+        Boxed_Value call_function(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const Function_Params &params,
+            const Type_Conversions_State &t_conversions, dispatch::Dispatch_Cache *t_cache = nullptr) const
         {
           uint_fast32_t loc = t_loc;
           const auto funs = get_function(t_name, loc);
           if (funs.first != loc) { t_loc = uint_fast32_t(funs.first);
 }
+          if (t_cache) {
+            return dispatch::dispatch(funs.second, params, t_conversions, *t_cache);
+          }
           return dispatch::dispatch(*funs.second, params, t_conversions);
         }
 
@@ -1121,7 +1440,7 @@ namespace chaiscript
 
         /// Returns true if a call can be made that consists of the first parameter
         /// (the function) with the remaining parameters as its arguments.
-        Boxed_Value call_exists(const std::vector<Boxed_Value> &params) const
+        Boxed_Value call_exists(const Function_Params &params) const
         {
           if (params.empty())
           {
@@ -1131,7 +1450,7 @@ namespace chaiscript
           const Const_Proxy_Function &f = this->boxed_cast<Const_Proxy_Function>(params[0]);
           const Type_Conversions_State convs(m_conversions, m_conversions.conversion_saves());
 
-          return const_var(f->call_match(std::vector<Boxed_Value>(params.begin() + 1, params.end()), convs));
+          return const_var(f->call_match(Function_Params{params.begin() + 1, params.end()}, convs));
         }
 
         /// Dump all system info to stdout
@@ -1198,10 +1517,22 @@ namespace chaiscript
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
           m_state = t_state;
+          publish_registry();
+        }
+
+        /// A reference returned by one call and passed to another can be stored by the callee
+        static void note_returned_references(Stack_Holder &t_s, const Boxed_Value &t_param)
+        {
+          if (t_param.is_ref() && t_param.is_return_value()) {
+            ++t_s.references_bound;
+          }
         }
 
         static void save_function_params(Stack_Holder &t_s, std::initializer_list<Boxed_Value> t_params)
         {
+          for (const auto &param : t_params) {
+            note_returned_references(t_s, param);
+          }
           t_s.call_params.back().insert(t_s.call_params.back().begin(), t_params);
         }
 
@@ -1209,12 +1540,16 @@ namespace chaiscript
         {
           for (auto &&param : t_params)
           {
+            note_returned_references(t_s, param);
             t_s.call_params.back().insert(t_s.call_params.back().begin(), std::move(param));
           }
         }
 
-        static void save_function_params(Stack_Holder &t_s, const std::vector<Boxed_Value> &t_params)
+        static void save_function_params(Stack_Holder &t_s, const Function_Params &t_params)
         {
+          for (const auto &param : t_params) {
+            note_returned_references(t_s, param);
+          }
           t_s.call_params.back().insert(t_s.call_params.back().begin(), t_params.begin(), t_params.end());
         }
 
@@ -1228,7 +1563,7 @@ namespace chaiscript
           save_function_params(*m_stack_holder, std::move(t_params));
         }
 
-        void save_function_params(const std::vector<Boxed_Value> &t_params)
+        void save_function_params(const Function_Params &t_params)
         {
           save_function_params(*m_stack_holder, t_params);
         }
@@ -1258,6 +1593,36 @@ namespace chaiscript
           }
         }
 
+        /// \returns the number of params saved in the current scope so far, the params saved after it
+        ///          can be released with release_function_params
+        size_t mark_function_params(Stack_Holder &t_s, Type_Conversions::Conversion_Saves &t_saves)
+        {
+          save_function_params(t_s, m_conversions.take_saves(t_saves));
+          return t_s.call_params.back().size();
+        }
+
+        /// Releases the params saved in the current scope since t_mark was taken. Conversion results
+        /// that were not saved yet are kept until the next release.
+        ///
+        /// If a reference was bound since t_references was taken it may point into those params,
+        /// they are kept until the scope is popped instead and t_mark and t_references move past them.
+        void release_function_params(Stack_Holder &t_s, Type_Conversions::Conversion_Saves &t_saves, size_t &t_mark, size_t &t_references)
+        {
+          auto &params = t_s.call_params.back();
+          if (t_s.references_bound != t_references) {
+            save_function_params(t_s, m_conversions.take_saves(t_saves));
+            t_mark = params.size();
+            t_references = t_s.references_bound;
+            return;
+          }
+
+          if (params.size() > t_mark) {
+            // newer params are at the front
+            params.erase(params.begin(), params.begin() + static_cast<std::ptrdiff_t>(params.size() - t_mark));
+          }
+          save_function_params(t_s, m_conversions.take_saves(t_saves));
+        }
+
         void new_function_call()
         {
           new_function_call(*m_stack_holder, m_conversions.conversion_saves());
@@ -1297,34 +1662,87 @@ namespace chaiscript
 
       private:
 
-        const std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int() const
+        /// \returns the registry snapshot of t_holder's thread, which is first brought up to
+        /// date if functions or globals were added since it was taken
+        const Registry &registry(const Stack_Holder &t_holder) const
         {
-          return m_state.m_boxed_functions;
+          if (t_holder.registry_version != m_registry_version.load(std::memory_order_acquire))
+          {
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            t_holder.registry = m_state.m_registry;
+            t_holder.registry_version = m_registry_version.load(std::memory_order_relaxed);
+          }
+
+          return *t_holder.registry;
         }
 
-        std::vector<std::pair<std::string, Boxed_Value>> &get_boxed_functions_int() 
+        const Registry &registry() const
         {
-          return m_state.m_boxed_functions;
+          return registry(*m_stack_holder);
         }
 
-        const std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int() const
+        /// \returns the registry, after giving the engine its own copy of it if snapshots still
+        /// refer to it. The caller must hold the unique lock and call publish_registry() after
+        /// modifying it.
+        Registry &writable_registry()
         {
-          return m_state.m_function_objects;
+          // this thread's snapshot would always force a copy, it is refreshed on its next lookup
+          m_stack_holder->registry.reset();
+          m_stack_holder->registry_version = 0;
+
+          if (m_state.m_registry.use_count() != 1) {
+            m_state.m_registry = std::make_shared<Registry>(*m_state.m_registry);
+          } else {
+            // pairs with the release of the last snapshot of it
+            std::atomic_thread_fence(std::memory_order_acquire);
+          }
+
+          return *m_state.m_registry;
         }
 
-        std::vector<std::pair<std::string, Proxy_Function>> &get_function_objects_int() 
+        /// Makes the current registry visible to lookups, the caller must hold the unique lock
+        void publish_registry()
         {
-          return m_state.m_function_objects;
+          m_registry_version.fetch_add(1, std::memory_order_release);
         }
 
-        const std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int() const
+        /// \returns true if the global at t_pos of t_globals is not const and is still the
+        ///          object the engine this one was forked from had there
+        bool is_fork_global(const Name_Table<Boxed_Value> &t_globals, const size_t t_pos) const
         {
-          return m_state.m_functions;
+          // entries are replaced, not modified, an entry that was not is the parent's
+          return t_pos < m_fork_globals.size() && &t_globals[t_pos] == &m_fork_globals[t_pos]
+            && !t_globals[t_pos].second.is_const();
         }
 
-        std::vector<std::pair<std::string, std::shared_ptr<std::vector<Proxy_Function>>>> &get_functions_int() 
+        /// Gives the fork its own copy of the global at t_pos, made with "clone", the first
+        /// time it uses the global. A global without a "clone" function stays shared.
+        /// \returns the fork's object
+        Boxed_Value fork_global(const size_t t_pos)
         {
-          return m_state.m_functions;
+          const auto &parent = m_fork_globals[t_pos];
+          Boxed_Value copy = parent.second;
+          try {
+            const Type_Conversions_State state(m_conversions, m_conversions.conversion_saves());
+            copy = call_function("clone", m_clone_loc, Function_Params{parent.second}, state);
+          } catch (const chaiscript::exception::dispatch_error &) {
+            // no way to copy it, the fork shares the object
+          }
+
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
+          const auto &globals = m_state.m_registry->globals;
+          const auto pos = globals.find(parent.first);
+          if (pos == globals.size()) {
+            return copy;
+          } else if (&globals[pos] != &parent) {
+            // another thread copied it first
+            return globals[pos].second;
+          }
+
+          writable_registry().globals.replace(pos, copy);
+          publish_registry();
+          return copy;
         }
 
         static bool function_less_than(const Proxy_Function &lhs, const Proxy_Function &rhs)
@@ -1413,92 +1831,67 @@ namespace chaiscript
 
 
 
-        template<typename Container, typename Key, typename Value>
-          static void add_keyed_value(Container &t_c, const Key &t_key, Value &&t_value)
-          {
-            auto itr = find_keyed_value(t_c, t_key);
-
-            if (itr == t_c.end()) {
-              t_c.reserve(t_c.size() + 1); // tightly control growth of memory usage here
-              t_c.emplace_back(t_key, std::forward<Value>(t_value));
-            } else {
-              typedef typename Container::value_type value_type;
-              *itr = value_type(t_key, std::forward<Value>(t_value));
-            }
-          }
-
-        template<typename Container, typename Key>
-        static typename Container::iterator find_keyed_value(Container &t_c, const Key &t_key)
-          {
-            return std::find_if(t_c.begin(), t_c.end(), 
-                [&t_key](const typename Container::value_type &o) {
-                  return o.first == t_key;
-                });
-          }
-
-        template<typename Container, typename Key>
-        static typename Container::const_iterator find_keyed_value(const Container &t_c, const Key &t_key)
-          {
-            return std::find_if(t_c.begin(), t_c.end(), 
-                [&t_key](const typename Container::value_type &o) {
-                  return o.first == t_key;
-                });
-          }
+        static std::pair<size_t, std::shared_ptr<std::vector<Proxy_Function>>> get_function_int(const Registry &t_registry, const size_t t_pos)
+        {
+          const auto &funs = t_registry.functions;
 
-        template<typename Container, typename Key>
-        static typename Container::const_iterator find_keyed_value(const Container &t_c, const Key &t_key, const size_t t_hint)
+          if (t_pos != funs.size())
           {
-            if (t_c.size() > t_hint && t_c[t_hint].first == t_key) {
-              return std::next(t_c.begin(), static_cast<typename std::iterator_traits<typename Container::const_iterator>::difference_type>(t_hint));
-            } else {
-              return find_keyed_value(t_c, t_key);
-            }
+            return std::make_pair(t_pos, funs[t_pos].second.functions);
+          } else {
+            return std::make_pair(size_t(0), std::make_shared<std::vector<Proxy_Function>>());
           }
+        }
 
 
         /// Implementation detail for adding a function. 
         /// \throws exception::name_conflict_error if there's a function matching the given one being added
-        void add_function(const Proxy_Function &t_f, const std::string &t_name)
+        void add_function(const Proxy_Function &t_f, const std::string &t_name, const bool t_replace = false)
         {
           chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
 
-          auto &funcs = get_functions_int();
+          auto &funcs = writable_registry().functions;
+          const auto pos = funcs.find(t_name);
 
-          auto itr = find_keyed_value(funcs, t_name);
+          Function_Registration reg;
 
-          Proxy_Function new_func =
-            [&]() -> Proxy_Function {
-              if (itr != funcs.end())
-              {
-                auto vec = *itr->second;
-                for (const auto &func : vec)
-                {
-                  if ((*t_f) == *(func))
-                  {
-                    throw chaiscript::exception::name_conflict_error(t_name);
-                  }
-                }
-
-                vec.reserve(vec.size() + 1); // tightly control vec growth
-                vec.push_back(t_f);
-                std::stable_sort(vec.begin(), vec.end(), &function_less_than);
-                itr->second = std::make_shared<std::vector<Proxy_Function>>(vec);
-                return std::make_shared<Dispatch_Function>(std::move(vec));
-              } else if (t_f->has_arithmetic_param()) {
-                // if the function is the only function but it also contains
-                // arithmetic operators, we must wrap it in a dispatch function
-                // to allow for automatic arithmetic type conversions
-                std::vector<Proxy_Function> vec({t_f});
-                funcs.emplace_back(t_name, std::make_shared<std::vector<Proxy_Function>>(vec));
-                return std::make_shared<Dispatch_Function>(std::move(vec));
-              } else {
-                funcs.emplace_back(t_name, std::make_shared<std::vector<Proxy_Function>>(std::initializer_list<Proxy_Function>({t_f})));
-                return t_f;
-              }
-            }();
+          if (pos != funcs.size())
+          {
+            auto vec = *funcs[pos].second.functions;
+            const auto existing = std::find_if(vec.begin(), vec.end(),
+                [&t_f](const Proxy_Function &t_func) { return (*t_f) == *t_func; });
+
+            if (existing == vec.end()) {
+              vec.reserve(vec.size() + 1); // tightly control vec growth
+              vec.push_back(t_f);
+              std::stable_sort(vec.begin(), vec.end(), &function_less_than);
+            } else if (t_replace) {
+              *existing = t_f;
+            } else {
+              throw chaiscript::exception::name_conflict_error(t_name);
+            }
+            reg.functions = std::make_shared<std::vector<Proxy_Function>>(std::move(vec));
+            if (reg.functions->size() == 1 && !t_f->has_arithmetic_param()) {
+              // t_f replaced the only function
+              reg.function_object = t_f;
+            } else {
+              reg.function_object = std::make_shared<Dispatch_Function>(reg.functions);
+            }
+          } else {
+            reg.functions = std::make_shared<std::vector<Proxy_Function>>(std::initializer_list<Proxy_Function>({t_f}));
+            if (t_f->has_arithmetic_param()) {
+              // if the function is the only function but it also contains
+              // arithmetic operators, we must wrap it in a dispatch function
+              // to allow for automatic arithmetic type conversions
+              reg.function_object = std::make_shared<Dispatch_Function>(reg.functions);
+            } else {
+              reg.function_object = t_f;
+            }
+          }
 
-          add_keyed_value(get_boxed_functions_int(), t_name, const_var(new_func));
-          add_keyed_value(get_function_objects_int(), t_name, std::move(new_func));
+          reg.boxed_function_object = const_var(reg.function_object);
+          funcs.set(t_name, std::move(reg));
+          publish_registry();
         }
 
         mutable chaiscript::detail::threading::shared_mutex m_mutex;
@@ -1511,6 +1904,13 @@ namespace chaiscript
         mutable std::atomic_uint_fast32_t m_method_missing_loc = {0};
 
         State m_state;
+        /// changes whenever m_state's registry does, so that lookups know to refresh their snapshot
+        std::atomic<size_t> m_registry_version{1};
+        /// the globals of the parent when this engine was forked from it, see fork_global()
+        const Name_Table<Boxed_Value> m_fork_globals;
+        std::atomic_uint_fast32_t m_clone_loc = {0};
+        /// shared by the engine the forks of a family descend from and all of the forks
+        const std::shared_ptr<Engine_Family> m_family;
     };
 
     class Dispatch_State
@@ -1555,6 +1955,18 @@ namespace chaiscript
           return m_engine.get().get_object(t_name, t_loc, m_stack_holder.get());
         }
 
+        Boxed_Value get_object(const std::string &t_name, std::atomic_uint_fast32_t &t_loc, const size_t t_hash) const {
+          return m_engine.get().get_object(t_name, t_loc, t_hash, m_stack_holder.get());
+        }
+
+        Boxed_Value *get_frame_object(const Frame_Slot &t_slot) const {
+          return Dispatch_Engine::get_frame_object(t_slot, m_stack_holder.get());
+        }
+
+        bool add_frame_object(Boxed_Value obj, const Frame_Slot &t_slot) const {
+          return Dispatch_Engine::add_frame_object(std::move(obj), t_slot, m_stack_holder.get());
+        }
+
       private:
         std::reference_wrapper<Dispatch_Engine> m_engine;
         std::reference_wrapper<Stack_Holder> m_stack_holder;
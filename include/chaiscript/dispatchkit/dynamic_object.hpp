@@ -7,10 +7,15 @@
 #ifndef CHAISCRIPT_DYNAMIC_OBJECT_HPP_
 #define CHAISCRIPT_DYNAMIC_OBJECT_HPP_
 
+#include <cassert>
+#include <deque>
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
+#include "../chaiscript_threading.hpp"
 #include "boxed_value.hpp"
 
 namespace chaiscript {
@@ -36,15 +41,178 @@ namespace chaiscript
       ~option_explicit_set() noexcept override = default;
     };
 
+    /// The layout of a Dynamic_Object: the names of its attributes and the slot each one is
+    /// stored in. Objects of a class that add the same attributes in the same order share
+    /// their shapes, adding an attribute moves an object to the next shape in the chain.
+    /// A shape only stores the attribute it adds and holds its parent for the rest, shapes
+    /// no object uses any more are freed. Shapes are immutable apart from the transitions
+    /// to their successors.
+    class Object_Shape : public std::enable_shared_from_this<Object_Shape>
+    {
+      public:
+        static const size_t npos = static_cast<size_t>(-1);
+
+        /// Longest chain of attributes, and most successors of a shape. Objects keep further
+        /// attributes in a dictionary of their own.
+        static const size_t max_size = 64;
+        static const size_t max_transitions = 64;
+
+        /// \returns the shape of an object of class t_type_name without any attributes
+        static std::shared_ptr<const Object_Shape> root(const std::string &t_type_name)
+        {
+          // never destroyed, objects can outlive the static objects of the program
+          static auto *roots = new std::map<std::string, std::weak_ptr<const Object_Shape>>();
+          static auto *mutex = new chaiscript::detail::threading::shared_mutex();
+
+          {
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(*mutex);
+            const auto itr = roots->find(t_type_name);
+            if (itr != roots->end()) {
+              if (auto shape = itr->second.lock()) {
+                return shape;
+              }
+            }
+          }
+
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(*mutex);
+          auto shape = (*roots)[t_type_name].lock();
+          if (!shape) {
+            // forget the classes no object is left of, before adding this one
+            prune(*roots);
+            shape = std::shared_ptr<const Object_Shape>(new Object_Shape(t_type_name));
+            (*roots)[t_type_name] = shape;
+          }
+          return shape;
+        }
+
+        const std::string &type_name() const
+        {
+          return m_class->m_type_name;
+        }
+
+        /// \returns the identity of the class, the root shape, which is the same for all
+        /// objects of the class whatever attributes they have
+        const Object_Shape *class_id() const
+        {
+          return m_class;
+        }
+
+        /// \returns the slot of the attribute, or npos if the shape does not have it
+        size_t find(const std::string &t_attr_name) const
+        {
+          for (const auto *shape = this; shape->m_size != 0; shape = shape->m_parent.get()) {
+            if (shape->m_attr_name == t_attr_name) {
+              return shape->m_size - 1;
+            }
+          }
+          return npos;
+        }
+
+        /// \returns the shape with t_attr_name added in the last slot, or null if this shape
+        /// cannot have any more successors
+        std::shared_ptr<const Object_Shape> add(const std::string &t_attr_name) const
+        {
+          if (m_size == max_size) {
+            return nullptr;
+          }
+
+          {
+            chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+            const auto itr = m_transitions.find(t_attr_name);
+            if (itr != m_transitions.end()) {
+              if (auto next = itr->second.lock()) {
+                return next;
+              }
+            }
+          }
+
+          // another thread can have added the successor since
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          auto next = m_transitions[t_attr_name].lock();
+          if (!next) {
+            if (m_transitions.size() > max_transitions) {
+              prune(m_transitions);
+              if (m_transitions.size() > max_transitions) {
+                m_transitions.erase(t_attr_name);
+                return nullptr;
+              }
+            }
+
+            next = std::shared_ptr<const Object_Shape>(new Object_Shape(shared_from_this(), t_attr_name));
+            m_transitions[t_attr_name] = next;
+          }
+          return next;
+        }
+
+        /// \returns the attribute names, by slot
+        std::vector<std::string> names() const
+        {
+          std::vector<std::string> names(m_size);
+          for (const auto *shape = this; shape->m_size != 0; shape = shape->m_parent.get()) {
+            names[shape->m_size - 1] = shape->m_attr_name;
+          }
+          return names;
+        }
+
+        size_t size() const
+        {
+          return m_size;
+        }
+
+      private:
+        explicit Object_Shape(std::string t_type_name)
+          : m_type_name(std::move(t_type_name)), m_class(this), m_size(0)
+        {
+        }
+
+        Object_Shape(std::shared_ptr<const Object_Shape> t_parent, std::string t_attr_name)
+          : m_class(t_parent->m_class), m_parent(std::move(t_parent)), m_attr_name(std::move(t_attr_name)), m_size(m_parent->m_size + 1)
+        {
+        }
+
+        /// Forgets the shapes of t_shapes that have been freed, the mutex guarding it must be held
+        static void prune(std::map<std::string, std::weak_ptr<const Object_Shape>> &t_shapes)
+        {
+          for (auto itr = t_shapes.begin(); itr != t_shapes.end();) {
+            if (itr->second.expired()) {
+              itr = t_shapes.erase(itr);
+            } else {
+              ++itr;
+            }
+          }
+        }
+
+        /// set on the root only
+        const std::string m_type_name;
+        const Object_Shape *const m_class;
+
+        const std::shared_ptr<const Object_Shape> m_parent;
+        const std::string m_attr_name;
+        const size_t m_size;
+
+        mutable chaiscript::detail::threading::shared_mutex m_mutex;
+        mutable std::map<std::string, std::weak_ptr<const Object_Shape>> m_transitions;
+    };
+
     class Dynamic_Object
     {
       public:
-        explicit Dynamic_Object(std::string t_type_name)
-          : m_type_name(std::move(t_type_name)), m_option_explicit(false)
+        explicit Dynamic_Object(const std::string &t_type_name)
+          : m_shape(Object_Shape::root(t_type_name))
         {
         }
 
-        Dynamic_Object() = default;
+        /// Creates an object of the class t_root is the empty shape of
+        explicit Dynamic_Object(std::shared_ptr<const Object_Shape> t_root)
+          : m_shape(std::move(t_root))
+        {
+          assert(m_shape->size() == 0);
+        }
+
+        Dynamic_Object()
+          : m_shape(Object_Shape::root(""))
+        {
+        }
 
         bool is_explicit() const
         {
@@ -58,7 +226,7 @@ namespace chaiscript
 
         std::string get_type_name() const
         {
-          return m_type_name;
+          return m_shape->type_name();
         }
 
         const Boxed_Value &operator[](const std::string &t_attr_name) const
@@ -73,27 +241,50 @@ namespace chaiscript
 
         const Boxed_Value &get_attr(const std::string &t_attr_name) const
         {
-          auto a = m_attrs.find(t_attr_name);
+          const auto slot = m_shape->find(t_attr_name);
+
+          if (slot != Object_Shape::npos) {
+            return m_slots[slot];
+          }
 
-          if (a != m_attrs.end()) {
-            return a->second;
+          const auto itr = m_dictionary.find(t_attr_name);
+          if (itr != m_dictionary.end()) {
+            return itr->second;
           } else {
             throw std::range_error("Attr not found '" + t_attr_name + "' and cannot be added to const obj");
           }
         }
 
         bool has_attr(const std::string &t_attr_name) const {
-          return m_attrs.find(t_attr_name) != m_attrs.end();
+          return m_shape->find(t_attr_name) != Object_Shape::npos || m_dictionary.count(t_attr_name) != 0;
         }
 
         Boxed_Value &get_attr(const std::string &t_attr_name)
         {
-          return m_attrs[t_attr_name];
+          const auto slot = m_shape->find(t_attr_name);
+
+          if (slot != Object_Shape::npos) {
+            return m_slots[slot];
+          }
+
+          const auto itr = m_dictionary.find(t_attr_name);
+          if (itr != m_dictionary.end()) {
+            return itr->second;
+          }
+
+          auto next = m_shape->add(t_attr_name);
+          if (next) {
+            m_shape = std::move(next);
+            m_slots.emplace_back();
+            return m_slots.back();
+          } else {
+            return m_dictionary[t_attr_name];
+          }
         }
 
         Boxed_Value &method_missing(const std::string &t_method_name)
         {
-          if (m_option_explicit && m_attrs.find(t_method_name) == m_attrs.end()) {
+          if (m_option_explicit && !has_attr(t_method_name)) {
             throw option_explicit_set(t_method_name);
           }
 
@@ -102,7 +293,7 @@ namespace chaiscript
 
         const Boxed_Value &method_missing(const std::string &t_method_name) const
         {
-          if (m_option_explicit && m_attrs.find(t_method_name) == m_attrs.end()) {
+          if (m_option_explicit && !has_attr(t_method_name)) {
             throw option_explicit_set(t_method_name);
           }
 
@@ -111,14 +302,40 @@ namespace chaiscript
 
         std::map<std::string, Boxed_Value> get_attrs() const
         {
-          return m_attrs;
+          std::map<std::string, Boxed_Value> attrs(m_dictionary);
+          const auto names = m_shape->names();
+          for (size_t i = 0; i < names.size(); ++i) {
+            attrs.emplace(names[i], m_slots[i]);
+          }
+          return attrs;
+        }
+
+        const Object_Shape &get_shape() const
+        {
+          return *m_shape;
+        }
+
+        const std::shared_ptr<const Object_Shape> &get_shared_shape() const
+        {
+          return m_shape;
+        }
+
+        /// \returns the attribute in t_slot of the object's shape
+        Boxed_Value &get_slot(const size_t t_slot)
+        {
+          assert(t_slot < m_slots.size());
+          return m_slots[t_slot];
         }
 
       private:
-        const std::string m_type_name = "";
+        std::shared_ptr<const Object_Shape> m_shape;
         bool m_option_explicit = false;
 
-        std::map<std::string, Boxed_Value> m_attrs;
+        /// a deque, references to attributes stay valid when attributes are added
+        std::deque<Boxed_Value> m_slots;
+
+        /// attributes added once the shape could not grow any more
+        std::map<std::string, Boxed_Value> m_dictionary;
     };
 
   }
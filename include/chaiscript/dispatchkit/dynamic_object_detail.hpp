@@ -7,6 +7,8 @@
 #ifndef CHAISCRIPT_DYNAMIC_OBJECT_DETAIL_HPP_
 #define CHAISCRIPT_DYNAMIC_OBJECT_DETAIL_HPP_
 
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <map>
 #include <memory>
@@ -47,7 +49,7 @@ namespace chaiscript
               const Proxy_Function &t_func,
               bool t_is_attribute = false)
             : Proxy_Function_Base(t_func->get_param_types(), t_func->get_arity()),
-              m_type_name(std::move(t_type_name)), m_func(t_func), m_doti(user_type<Dynamic_Object>()),
+              m_type_name(std::move(t_type_name)), m_class(class_of(m_type_name)), m_func(t_func), m_doti(user_type<Dynamic_Object>()),
               m_is_attribute(t_is_attribute)
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
@@ -60,7 +62,7 @@ namespace chaiscript
               const Type_Info &t_ti,
               bool t_is_attribute = false)
             : Proxy_Function_Base(build_param_types(t_func->get_param_types(), t_ti), t_func->get_arity()),
-              m_type_name(std::move(t_type_name)), m_func(t_func), m_ti(t_ti.is_undef()?nullptr:new Type_Info(t_ti)), m_doti(user_type<Dynamic_Object>()),
+              m_type_name(std::move(t_type_name)), m_class(class_of(m_type_name)), m_func(t_func), m_ti(t_ti.is_undef()?nullptr:new Type_Info(t_ti)), m_doti(user_type<Dynamic_Object>()),
               m_is_attribute(t_is_attribute)
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
@@ -83,9 +85,20 @@ namespace chaiscript
 
           bool is_attribute_function() const override { return m_is_attribute; } 
 
-          bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+          const std::string &get_type_name() const
           {
-            if (dynamic_object_typename_match(vals, m_type_name, m_ti, t_conversions))
+            return m_type_name;
+          }
+
+          /// \returns true if the function applies to objects of the class t_class is the identity of
+          bool matches_class(const Object_Shape *t_class) const
+          {
+            return !m_class || m_class.get() == t_class;
+          }
+
+          bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
+          {
+            if (dynamic_object_typename_match(vals))
             {
               return m_func->call_match(vals, t_conversions);
             } else {
@@ -99,9 +112,9 @@ namespace chaiscript
           }
 
         protected:
-          Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+          Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
           {
-            if (dynamic_object_typename_match(params, m_type_name, m_ti, t_conversions))
+            if (dynamic_object_typename_match(params))
             {
               return (*m_func)(params, t_conversions);
             } else {
@@ -109,9 +122,15 @@ namespace chaiscript
             } 
           }
 
-          bool compare_first_type(const Boxed_Value &bv, const Type_Conversions_State &t_conversions) const override
+          bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
           {
-            return dynamic_object_typename_match(bv, m_type_name, m_ti, t_conversions);
+            return dynamic_object_typename_match(params)
+              && m_func->try_call(params, t_conversions, t_result);
+          }
+
+          bool compare_first_type(const Boxed_Value &bv, const Type_Conversions_State &) const override
+          {
+            return dynamic_object_typename_match(bv);
           }
 
         private:
@@ -126,21 +145,27 @@ namespace chaiscript
             return types;
           }
 
-          bool dynamic_object_typename_match(const Boxed_Value &bv, const std::string &name,
-              const std::unique_ptr<Type_Info> &ti, const Type_Conversions_State &t_conversions) const
+          /// \returns the identity of the class t_type_name, or null for "Dynamic_Object",
+          /// which matches objects of every class
+          static std::shared_ptr<const Object_Shape> class_of(const std::string &t_type_name)
+          {
+            if (t_type_name == "Dynamic_Object") {
+              return nullptr;
+            } else {
+              return Object_Shape::root(t_type_name);
+            }
+          }
+
+          bool dynamic_object_typename_match(const Boxed_Value &bv) const
           {
             if (bv.get_type_info().bare_equal(m_doti))
             {
-              try {
-                const Dynamic_Object &d = boxed_cast<const Dynamic_Object &>(bv, &t_conversions);
-                return name == "Dynamic_Object" || d.get_type_name() == name;
-              } catch (const std::bad_cast &) {
-                return false;
-              } 
+              const auto *d = static_cast<const Dynamic_Object *>(bv.get_const_ptr());
+              return d != nullptr && matches_class(d->get_shape().class_id());
             } else {
-              if (ti)
+              if (m_ti)
               {
-                return bv.get_type_info().bare_equal(*ti);
+                return bv.get_type_info().bare_equal(*m_ti);
               } else {
                 return false;
               }
@@ -148,18 +173,19 @@ namespace chaiscript
 
           }
 
-          bool dynamic_object_typename_match(const std::vector<Boxed_Value> &bvs, const std::string &name,
-              const std::unique_ptr<Type_Info> &ti, const Type_Conversions_State &t_conversions) const
+          bool dynamic_object_typename_match(const Function_Params &bvs) const
           {
             if (!bvs.empty())
             {
-              return dynamic_object_typename_match(bvs[0], name, ti, t_conversions);
+              return dynamic_object_typename_match(bvs[0]);
             } else {
               return false;
             }
           }
 
           std::string m_type_name;
+          /// the root shape of the class, compared with the object's instead of its type name
+          std::shared_ptr<const Object_Shape> m_class;
           Proxy_Function m_func;
           std::unique_ptr<Type_Info> m_ti;
           const Type_Info m_doti;
@@ -180,7 +206,7 @@ namespace chaiscript
               std::string t_type_name,
               const Proxy_Function &t_func)
             : Proxy_Function_Base(build_type_list(t_func->get_param_types()), t_func->get_arity() - 1),
-              m_type_name(std::move(t_type_name)), m_func(t_func)
+              m_type_name(std::move(t_type_name)), m_func(t_func), m_root(Object_Shape::root(m_type_name))
           {
             assert( (t_func->get_arity() > 0 || t_func->get_arity() < 0)
                 && "Programming error, Dynamic_Object_Function must have at least one parameter (this)");
@@ -205,30 +231,117 @@ namespace chaiscript
             return (dc != nullptr) && dc->m_type_name == m_type_name && (*dc->m_func) == (*m_func);
           }
 
-          bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+          bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
           {
-            std::vector<Boxed_Value> new_vals{Boxed_Value(Dynamic_Object(m_type_name))};
-            new_vals.insert(new_vals.end(), vals.begin(), vals.end());
+            Param_List new_vals;
+            new_vals.reserve(vals.size() + 1);
+            new_vals.push_back(Boxed_Value(Dynamic_Object(m_root)));
+            for (const auto &val : vals) {
+              new_vals.push_back(val);
+            }
 
             return m_func->call_match(new_vals, t_conversions);
           }
 
         protected:
-          Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+          Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
           {
-            auto bv = Boxed_Value(Dynamic_Object(m_type_name), true);
-            std::vector<Boxed_Value> new_params{bv};
-            new_params.insert(new_params.end(), params.begin(), params.end());
-
+            auto bv = Boxed_Value(Dynamic_Object(m_root), true);
+            Param_List new_params;
+            build_param_list(bv, params, new_params);
             (*m_func)(new_params, t_conversions);
 
             return bv;
           }
 
+          bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+          {
+            auto bv = Boxed_Value(Dynamic_Object(m_root), true);
+            Param_List new_params;
+            build_param_list(bv, params, new_params);
+            Boxed_Value ignored;
+            if (!m_func->try_call(new_params, t_conversions, ignored)) {
+              return false;
+            }
+
+            t_result = bv;
+            return true;
+          }
+
         private:
+          static void build_param_list(const Boxed_Value &t_this, const Function_Params &params, Param_List &t_new_params)
+          {
+            t_new_params.reserve(params.size() + 1);
+            t_new_params.push_back(t_this);
+            for (const auto &param : params) {
+              t_new_params.push_back(param);
+            }
+          }
+
           const std::string m_type_name;
           const Proxy_Function m_func;
+          /// the shape objects of the class start out with
+          const std::shared_ptr<const Object_Shape> m_root;
+
+      };
+
+
+      /// Inline cache of an attribute read such as "this.x". Remembers the slot the attribute
+      /// is stored in for objects of a shape, so that a read from an object of the same shape
+      /// does not dispatch. Entries are made only while the functions of the attribute's name
+      /// are all attribute getters declared with "attr", and are keyed on their overload set,
+      /// which Dispatch_Engine replaces when a function is added. Entries hold the set and the
+      /// shape weakly and are replaced first once either is gone, see
+      /// chaiscript::detail::Inline_Cache.
+      class Attribute_Cache
+      {
+        public:
+          /// \returns the attribute of t_obj, null if there is no entry for the shape of t_obj
+          Boxed_Value *find(const void *t_funcs, Dynamic_Object &t_obj) const
+          {
+            // t_obj holds its shape and the caller the set, live ones at the same addresses are the same
+            const auto *shape = &t_obj.get_shape();
+            return m_entries.find([&](const Entry &t_entry) {
+                return (t_entry.shape_address == shape && t_entry.funcs_address == t_funcs && !t_entry.funcs.expired() && !t_entry.shape.expired())
+                  ? &t_obj.get_slot(t_entry.slot) : nullptr;
+              });
+          }
+
+          /// Records the slot of t_attr_name in t_obj, after it was read by calling t_funcs
+          void add(const std::shared_ptr<const std::vector<Proxy_Function>> &t_funcs, const std::string &t_attr_name, const Dynamic_Object &t_obj)
+          {
+            const auto *class_id = t_obj.get_shape().class_id();
+            size_t getters = 0;
+            for (const auto &func : *t_funcs) {
+              const auto *getter = dynamic_cast<const Dynamic_Object_Function *>(func.get());
+              if (getter == nullptr || !getter->is_attribute_function()) {
+                return;
+              } else if (getter->matches_class(class_id)) {
+                ++getters;
+              }
+            }
 
+            const auto slot = t_obj.get_shape().find(t_attr_name);
+            if (getters != 1 || slot == Object_Shape::npos) {
+              return;
+            }
+
+            const auto &shape = t_obj.get_shared_shape();
+            m_entries.add(std::make_unique<const Entry>(Entry{t_funcs, t_funcs.get(), shape, shape.get(), slot}),
+                [](const Entry &t_entry) { return t_entry.funcs.expired() || t_entry.shape.expired(); });
+          }
+
+        private:
+          struct Entry
+          {
+            std::weak_ptr<const void> funcs;
+            const void *funcs_address;
+            std::weak_ptr<const Object_Shape> shape;
+            const Object_Shape *shape_address;
+            size_t slot;
+          };
+
+          chaiscript::detail::Inline_Cache<Entry> m_entries;
       };
     }
   }
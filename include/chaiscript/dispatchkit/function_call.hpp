@@ -21,6 +21,7 @@ class Boxed_Value;
 class Type_Conversions_State;
 namespace detail {
 template <typename T> struct Cast_Helper;
+template <typename T> struct Cast_Check;
 }  // namespace detail
 }  // namespace chaiscript
 
@@ -121,6 +122,22 @@ namespace chaiscript
           }
         }
       };
+
+    /// Function objects are built from a Proxy_Function or are held as std::function
+    template<typename Signature>
+      struct Cast_Check<std::function<Signature> >
+      {
+        static bool possible(const Boxed_Value &ob) noexcept
+        {
+          return ob.get_type_info().bare_equal(user_type<Const_Proxy_Function>())
+            || ob.get_type_info().bare_equal(user_type<std::function<Signature>>());
+        }
+      };
+
+    template<typename Signature>
+      struct Cast_Check<const std::function<Signature> &> : Cast_Check<std::function<Signature> >
+      {
+      };
   }
 }
 
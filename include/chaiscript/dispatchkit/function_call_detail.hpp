@@ -7,6 +7,7 @@
 #ifndef CHAISCRIPT_FUNCTION_CALL_DETAIL_HPP_
 #define CHAISCRIPT_FUNCTION_CALL_DETAIL_HPP_
 
+#include <array>
 #include <functional>
 #include <memory>
 #include <string>
@@ -30,16 +31,10 @@ namespace chaiscript
       template<typename Ret, bool is_arithmetic>
         struct Function_Caller_Ret
         {
-          static Ret call(const std::vector<Const_Proxy_Function> &t_funcs, 
-              const std::vector<Boxed_Value> &params, const Type_Conversions_State *t_conversions)
+          static Ret call(const std::shared_ptr<const std::vector<Const_Proxy_Function>> &t_funcs, 
+              const Function_Params &params, const Type_Conversions_State &t_conversions, Dispatch_Cache &t_cache)
           {
-            if (t_conversions != nullptr) {
-              return boxed_cast<Ret>(dispatch::dispatch(t_funcs, params, *t_conversions), t_conversions);
-            } else {
-              Type_Conversions conv;
-              Type_Conversions_State state(conv, conv.conversion_saves());
-              return boxed_cast<Ret>(dispatch::dispatch(t_funcs, params, state), t_conversions);
-            }
+            return boxed_cast<Ret>(dispatch::dispatch(t_funcs, params, t_conversions, t_cache), &t_conversions);
           }
         };
 
@@ -49,16 +44,10 @@ namespace chaiscript
       template<typename Ret>
         struct Function_Caller_Ret<Ret, true>
         {
-          static Ret call(const std::vector<Const_Proxy_Function> &t_funcs, 
-              const std::vector<Boxed_Value> &params, const Type_Conversions_State *t_conversions)
+          static Ret call(const std::shared_ptr<const std::vector<Const_Proxy_Function>> &t_funcs, 
+              const Function_Params &params, const Type_Conversions_State &t_conversions, Dispatch_Cache &t_cache)
           {
-            if (t_conversions != nullptr) {
-              return Boxed_Number(dispatch::dispatch(t_funcs, params, *t_conversions)).get_as<Ret>();
-            } else {
-              Type_Conversions conv;
-              Type_Conversions_State state(conv, conv.conversion_saves());
-              return Boxed_Number(dispatch::dispatch(t_funcs, params, state)).get_as<Ret>();
-            }
+            return Boxed_Number(dispatch::dispatch(t_funcs, params, t_conversions, t_cache)).get_as<Ret>();
           }
         };
 
@@ -69,47 +58,44 @@ namespace chaiscript
       template<>
         struct Function_Caller_Ret<void, false>
         {
-          static void call(const std::vector<Const_Proxy_Function> &t_funcs, 
-              const std::vector<Boxed_Value> &params, const Type_Conversions_State *t_conversions)
+          static void call(const std::shared_ptr<const std::vector<Const_Proxy_Function>> &t_funcs, 
+              const Function_Params &params, const Type_Conversions_State &t_conversions, Dispatch_Cache &t_cache)
           {
-            if (t_conversions != nullptr) {
-              dispatch::dispatch(t_funcs, params, *t_conversions);
-            } else {
-              Type_Conversions conv;
-              Type_Conversions_State state(conv, conv.conversion_saves());
-              dispatch::dispatch(t_funcs, params, state);
-            }
+            dispatch::dispatch(t_funcs, params, t_conversions, t_cache);
           }
         };
 
       /**
        * used internally for unwrapping a function call's types
+       *
+       * The function chosen for each list of argument types is remembered, copies of the
+       * std::function share the functions and the cache.
        */
       template<typename Ret, typename ... Param>
         struct Build_Function_Caller_Helper
         {
           Build_Function_Caller_Helper(std::vector<Const_Proxy_Function> t_funcs, const Type_Conversions *t_conversions)
-            : m_funcs(std::move(t_funcs)),
-              m_conversions(t_conversions)
+            : m_funcs(std::make_shared<const std::vector<Const_Proxy_Function>>(std::move(t_funcs))),
+              m_conversions(t_conversions?*t_conversions:empty_conversions()),
+              m_cache(std::make_shared<Dispatch_Cache>())
           {
           }
 
           template<typename ... P>
           Ret operator()(P&&  ...  param)
           {
-            if (m_conversions) {
-              Type_Conversions_State state(*m_conversions, m_conversions->conversion_saves());
-              return Function_Caller_Ret<Ret, std::is_arithmetic<Ret>::value && !std::is_same<Ret, bool>::value>::call(m_funcs, { 
-                  box<P>(std::forward<P>(param))...
-                  }, &state
-                  );
-            } else {
-              return Function_Caller_Ret<Ret, std::is_arithmetic<Ret>::value && !std::is_same<Ret, bool>::value>::call(m_funcs, { 
-                  box<P>(std::forward<P>(param))...
-                  }, nullptr
-                  );
-            }
+            const std::array<Boxed_Value, sizeof...(P)> params{{box<P>(std::forward<P>(param))...}};
 
+            Type_Conversions_State state(m_conversions.get(), m_conversions.get().conversion_saves());
+            return Function_Caller_Ret<Ret, std::is_arithmetic<Ret>::value && !std::is_same<Ret, bool>::value>::call(m_funcs, params, state, *m_cache);
+          }
+
+          /// Used when the caller was built without an engine's conversions. Never destroyed,
+          /// its thread local state may already be gone during static destruction
+          static const Type_Conversions &empty_conversions()
+          {
+            static const Type_Conversions *conversions = new Type_Conversions();
+            return *conversions;
           }
 
           template<typename P, typename Q>
@@ -131,8 +117,9 @@ namespace chaiscript
           }
 
 
-          std::vector<Const_Proxy_Function> m_funcs;
-          const Type_Conversions *m_conversions;
+          std::shared_ptr<const std::vector<Const_Proxy_Function>> m_funcs;
+          std::reference_wrapper<const Type_Conversions> m_conversions;
+          std::shared_ptr<Dispatch_Cache> m_cache;
         };
 
 
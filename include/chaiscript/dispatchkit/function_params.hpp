@@ -0,0 +1,173 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_FUNCTION_PARAMS_HPP_
+#define CHAISCRIPT_FUNCTION_PARAMS_HPP_
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "boxed_value.hpp"
+
+namespace chaiscript
+{
+  /// A non-owning view of the parameters passed to a function. The values it refers
+  /// to must outlive it, it is only meant to be passed down a call.
+  class Function_Params
+  {
+    public:
+      Function_Params(const Boxed_Value * const t_begin, const Boxed_Value * const t_end)
+        : m_begin(t_begin), m_end(t_end)
+      {
+      }
+
+      explicit Function_Params(const Boxed_Value &bv)
+        : m_begin(&bv), m_end(m_begin + 1)
+      {
+      }
+
+      /// explicit, so that a temporary vector cannot silently outlive the view of it
+      explicit Function_Params(const std::vector<Boxed_Value> &vec)
+        : m_begin(vec.data()), m_end(vec.data() + vec.size())
+      {
+      }
+
+      template<size_t Size>
+      Function_Params(const std::array<Boxed_Value, Size> &a)
+        : m_begin(a.data()), m_end(a.data() + Size)
+      {
+      }
+
+      const Boxed_Value &operator[](const size_t t_i) const
+      {
+        assert(t_i < size());
+        return m_begin[t_i];
+      }
+
+      const Boxed_Value *begin() const { return m_begin; }
+      const Boxed_Value *end() const { return m_end; }
+
+      const Boxed_Value &front() const { return *m_begin; }
+
+      size_t size() const { return static_cast<size_t>(m_end - m_begin); }
+
+      bool empty() const { return m_begin == m_end; }
+
+      std::vector<Boxed_Value> to_vector() const
+      {
+        return std::vector<Boxed_Value>(m_begin, m_end);
+      }
+
+    private:
+      const Boxed_Value *m_begin;
+      const Boxed_Value *m_end;
+  };
+
+  /// Builds the parameter list for a call. The first inline_capacity values are stored
+  /// in the object itself, so that building the parameters of most calls does not allocate.
+  class Param_List
+  {
+    public:
+      static const size_t inline_capacity = 6;
+
+      Param_List() = default;
+      Param_List(const Param_List &) = delete;
+      Param_List &operator=(const Param_List &) = delete;
+
+      ~Param_List()
+      {
+        clear();
+      }
+
+      void reserve(const size_t t_size)
+      {
+        if (t_size > inline_capacity) {
+          spill(t_size);
+        }
+      }
+
+      void push_back(Boxed_Value t_bv)
+      {
+        if (m_spilled) {
+          m_heap.push_back(std::move(t_bv));
+        } else if (m_size < inline_capacity) {
+          new (&m_inline[m_size]) Boxed_Value(std::move(t_bv));
+          ++m_size;
+        } else {
+          spill(m_size + 1);
+          m_heap.push_back(std::move(t_bv));
+        }
+      }
+
+      void clear()
+      {
+        if (m_spilled) {
+          m_heap.clear();
+        } else {
+          for (size_t i = 0; i < m_size; ++i) {
+            data()[i].~Boxed_Value();
+          }
+          m_size = 0;
+        }
+      }
+
+      size_t size() const { return m_spilled ? m_heap.size() : m_size; }
+      bool empty() const { return size() == 0; }
+
+      const Boxed_Value &operator[](const size_t t_i) const
+      {
+        assert(t_i < size());
+        return data()[t_i];
+      }
+
+      const Boxed_Value *begin() const { return data(); }
+      const Boxed_Value *end() const { return data() + size(); }
+
+      operator Function_Params() const
+      {
+        return Function_Params(begin(), end());
+      }
+
+    private:
+      Boxed_Value *data()
+      {
+        return m_spilled ? m_heap.data() : reinterpret_cast<Boxed_Value *>(&m_inline[0]);
+      }
+
+      const Boxed_Value *data() const
+      {
+        return m_spilled ? m_heap.data() : reinterpret_cast<const Boxed_Value *>(&m_inline[0]);
+      }
+
+      void spill(const size_t t_size)
+      {
+        if (m_spilled) {
+          m_heap.reserve(t_size);
+          return;
+        }
+
+        m_heap.reserve(t_size);
+        for (size_t i = 0; i < m_size; ++i) {
+          m_heap.push_back(std::move(data()[i]));
+          data()[i].~Boxed_Value();
+        }
+        m_size = 0;
+        m_spilled = true;
+      }
+
+      std::aligned_storage_t<sizeof(Boxed_Value), alignof(Boxed_Value)> m_inline[inline_capacity];
+      size_t m_size = 0;
+      bool m_spilled = false;
+      std::vector<Boxed_Value> m_heap;
+  };
+}
+
+#endif
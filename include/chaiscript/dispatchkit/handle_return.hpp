@@ -34,14 +34,16 @@ namespace chaiscript
         struct Handle_Return
         {
           template<typename T,
-                   typename = typename std::enable_if<std::is_pod<typename std::decay<T>::type>::value>::type>
+                   typename = typename std::enable_if<std::is_pod<typename std::decay<T>::type>::value
+                     || chaiscript::detail::Stored_Inline<typename std::decay<T>::type>::value>::type>
           static Boxed_Value handle(T r)
           {
             return Boxed_Value(std::move(r), true);
           }
 
           template<typename T,
-                   typename = typename std::enable_if<!std::is_pod<typename std::decay<T>::type>::value>::type>
+                   typename = typename std::enable_if<!std::is_pod<typename std::decay<T>::type>::value
+                     && !chaiscript::detail::Stored_Inline<typename std::decay<T>::type>::value>::type>
           static Boxed_Value handle(T &&r)
           {
             return Boxed_Value(std::make_shared<T>(std::forward<T>(r)), true);
@@ -0,0 +1,111 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_INLINE_CACHE_HPP_
+#define CHAISCRIPT_INLINE_CACHE_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "../chaiscript_threading.hpp"
+
+namespace chaiscript
+{
+  namespace detail
+  {
+    /// The entries of an inline cache, which lookups read without locking.
+    ///
+    /// Entries are immutable once published. A new entry takes the place of a stale one,
+    /// or else of the oldest one, so a call site used by more engines or types than the
+    /// cache holds keeps caching the latest ones. An entry that lost its place is freed
+    /// once no lookup is running, each lookup counts itself in while it reads the entries.
+    template<typename Entry, size_t Size = 4>
+      class Inline_Cache
+      {
+        public:
+          Inline_Cache()
+          {
+            for (auto &slot : m_slots) {
+              slot.store(nullptr);
+            }
+          }
+
+          Inline_Cache(const Inline_Cache &) = delete;
+          Inline_Cache &operator=(const Inline_Cache &) = delete;
+
+          /// Calls t_lookup with each entry, in the order they were added, until it returns
+          /// a value that converts to true. The entry must not be used after t_lookup returns.
+          /// \returns the last value t_lookup returned, or a default constructed one
+          template<typename Lookup>
+            auto find(Lookup &&t_lookup) const -> decltype(t_lookup(std::declval<const Entry &>()))
+            {
+              decltype(t_lookup(std::declval<const Entry &>())) result{};
+
+              m_lookups.fetch_add(1);
+              for (const auto &slot : m_slots) {
+                const auto *entry = slot.load();
+                if (entry == nullptr) {
+                  break;
+                }
+
+                result = t_lookup(*entry);
+                if (result) {
+                  break;
+                }
+              }
+              m_lookups.fetch_sub(1);
+
+              return result;
+            }
+
+          /// Publishes t_entry in the place of the first entry t_stale returns true for,
+          /// or else of the oldest entry
+          template<typename Stale>
+            void add(std::unique_ptr<const Entry> t_entry, Stale &&t_stale)
+            {
+              chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::mutex> l(m_mutex);
+
+              auto place = m_oldest;
+              for (size_t i = 0; i < Size; ++i) {
+                if (!m_entries[i] || t_stale(*m_entries[i])) {
+                  place = i;
+                  break;
+                }
+              }
+
+              if (place == m_oldest) {
+                m_oldest = (m_oldest + 1) % Size;
+              }
+
+              // a lookup that counted itself in after this store cannot read the entry replaced
+              m_slots[place].store(t_entry.get());
+              if (m_entries[place]) {
+                m_replaced.push_back(std::move(m_entries[place]));
+              }
+              m_entries[place] = std::move(t_entry);
+
+              if (m_lookups.load() == 0) {
+                m_replaced.clear();
+              }
+            }
+
+        private:
+          std::array<std::atomic<const Entry *>, Size> m_slots;
+          std::array<std::unique_ptr<const Entry>, Size> m_entries;
+          /// entries that lost their place while a lookup was running
+          std::vector<std::unique_ptr<const Entry>> m_replaced;
+          size_t m_oldest = 0;
+          mutable std::atomic<size_t> m_lookups{0};
+          chaiscript::detail::threading::mutex m_mutex;
+      };
+  }
+}
+
+#endif
@@ -0,0 +1,206 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_NAME_TABLE_HPP_
+#define CHAISCRIPT_NAME_TABLE_HPP_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace chaiscript
+{
+  namespace detail
+  {
+    /// Hash of a name, as used by Name_Table lookups
+    inline size_t hash_name(const std::string &t_name)
+    {
+      return std::hash<std::string>()(t_name);
+    }
+
+    /// Persistent map from names to values that keeps its entries in insertion order.
+    ///
+    /// Copies of a table share their entries. Changing an entry copies only the chunk of
+    /// entries holding it and the index bucket of its name, and only if another table still
+    /// shares them, so copies are cheap to take and to modify. A table that is never
+    /// modified can be read from any number of threads.
+    ///
+    /// The position of an entry never changes, which makes positions usable as lookup hints.
+    template<typename Value>
+      class Name_Table
+      {
+        public:
+          typedef std::pair<std::string, Value> Entry;
+
+          class const_iterator
+          {
+            public:
+              typedef std::forward_iterator_tag iterator_category;
+              typedef Entry value_type;
+              typedef std::ptrdiff_t difference_type;
+              typedef const Entry *pointer;
+              typedef const Entry &reference;
+
+              const_iterator(const Name_Table *t_table, const size_t t_pos)
+                : m_table(t_table), m_pos(t_pos)
+              {
+              }
+
+              const Entry &operator*() const { return (*m_table)[m_pos]; }
+              const Entry *operator->() const { return &(*m_table)[m_pos]; }
+
+              const_iterator &operator++()
+              {
+                ++m_pos;
+                return *this;
+              }
+
+              bool operator==(const const_iterator &t_rhs) const { return m_pos == t_rhs.m_pos; }
+              bool operator!=(const const_iterator &t_rhs) const { return m_pos != t_rhs.m_pos; }
+
+            private:
+              const Name_Table *m_table;
+              size_t m_pos;
+          };
+
+          size_t size() const { return m_size; }
+          bool empty() const { return m_size == 0; }
+
+          const_iterator begin() const { return const_iterator(this, 0); }
+          const_iterator end() const { return const_iterator(this, m_size); }
+
+          const Entry &operator[](const size_t t_pos) const
+          {
+            assert(t_pos < m_size);
+            return *(*m_chunks[t_pos / chunk_size])[t_pos % chunk_size];
+          }
+
+          /// \returns the position of t_name, or size() if it is not in the table.
+          /// t_hash is the hash_name() of t_name
+          size_t find(const std::string &t_name, const size_t t_hash) const
+          {
+            if (!m_buckets.empty()) {
+              for (const auto &slot : *m_buckets[t_hash % m_buckets.size()])
+              {
+                if (slot.first == t_hash && (*this)[slot.second].first == t_name) {
+                  return slot.second;
+                }
+              }
+            }
+
+            return m_size;
+          }
+
+          size_t find(const std::string &t_name) const
+          {
+            return find(t_name, hash_name(t_name));
+          }
+
+          /// Finds t_name, trying the position t_hint first
+          size_t find_hinted(const std::string &t_name, const size_t t_hint) const
+          {
+            if (t_hint < m_size && (*this)[t_hint].first == t_name) {
+              return t_hint;
+            }
+
+            return find(t_name);
+          }
+
+          size_t find_hinted(const std::string &t_name, const size_t t_hint, const size_t t_hash) const
+          {
+            if (t_hint < m_size && (*this)[t_hint].first == t_name) {
+              return t_hint;
+            }
+
+            return find(t_name, t_hash);
+          }
+
+          /// Sets the value of t_name, adding it at the end of the table if it is not there yet
+          /// \returns the position of t_name
+          size_t set(const std::string &t_name, Value t_value)
+          {
+            const auto name_hash = hash_name(t_name);
+            const auto pos = find(t_name, name_hash);
+
+            if (pos != m_size) {
+              replace(pos, std::move(t_value));
+              return pos;
+            }
+
+            if (m_size % chunk_size == 0) {
+              m_chunks.push_back(std::make_shared<Chunk>());
+              m_chunks.back()->reserve(chunk_size);
+            }
+
+            writable(m_chunks.back()).push_back(std::make_shared<const Entry>(t_name, std::move(t_value)));
+            ++m_size;
+
+            if (m_size > m_buckets.size() * max_load) {
+              rehash();
+            } else {
+              writable(m_buckets[name_hash % m_buckets.size()]).emplace_back(name_hash, pos);
+            }
+
+            return pos;
+          }
+
+          /// Replaces the value of the entry at t_pos
+          void replace(const size_t t_pos, Value t_value)
+          {
+            assert(t_pos < m_size);
+            auto &entry = writable(m_chunks[t_pos / chunk_size])[t_pos % chunk_size];
+            entry = std::make_shared<const Entry>(entry->first, std::move(t_value));
+          }
+
+        private:
+          typedef std::vector<std::shared_ptr<const Entry>> Chunk;
+          typedef std::vector<std::pair<size_t, size_t>> Bucket;
+
+          static const size_t chunk_size = 32;
+          static const size_t max_load = 8;
+
+          /// \returns t_ptr's object, after giving t_ptr its own copy of it if other tables share it
+          template<typename T>
+            static T &writable(std::shared_ptr<T> &t_ptr)
+            {
+              if (t_ptr.use_count() != 1) {
+                t_ptr = std::make_shared<T>(*t_ptr);
+              } else {
+                // pairs with the release of the last other owner, which may have read it
+                std::atomic_thread_fence(std::memory_order_acquire);
+              }
+              return *t_ptr;
+            }
+
+          void rehash()
+          {
+            std::vector<std::shared_ptr<Bucket>> buckets(m_buckets.empty() ? 64 : m_buckets.size() * 2);
+            for (auto &bucket : buckets) {
+              bucket = std::make_shared<Bucket>();
+            }
+
+            for (size_t pos = 0; pos < m_size; ++pos) {
+              const auto name_hash = hash_name((*this)[pos].first);
+              buckets[name_hash % buckets.size()]->emplace_back(name_hash, pos);
+            }
+
+            m_buckets = std::move(buckets);
+          }
+
+          std::vector<std::shared_ptr<Chunk>> m_chunks;
+          std::vector<std::shared_ptr<Bucket>> m_buckets;
+          size_t m_size = 0;
+      };
+  }
+}
+
+#endif
@@ -0,0 +1,342 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_POOL_ALLOCATOR_HPP_
+#define CHAISCRIPT_POOL_ALLOCATOR_HPP_
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+#ifndef CHAISCRIPT_NO_THREADS
+#include <mutex>
+#endif
+
+#include "../chaiscript_defines.hpp"
+
+#if !defined(CHAISCRIPT_NO_THREADS) && !defined(CHAISCRIPT_HAS_THREAD_LOCAL)
+#error "CHAISCRIPT_POOL_ALLOCATOR requires thread_local support"
+#endif
+
+/// \file
+///
+/// Pool allocator for the small, short lived objects ChaiScript creates while evaluating,
+/// such as the internal data of every Boxed_Value. It is used when CHAISCRIPT_POOL_ALLOCATOR
+/// is defined, see chaiscript::detail::allocate_shared.
+///
+/// Memory is reserved in slabs, one size class at a time. Each thread takes blocks from a
+/// free list of its own, so allocating and freeing does not lock. A thread that collects
+/// more free blocks than it needs, or that exits, hands them back to a shared depot.
+
+namespace chaiscript
+{
+  /// Counters of the pool allocator, see chaiscript::pool_statistics
+  struct Pool_Statistics
+  {
+    /// slabs reserved from the system by all threads
+    size_t slabs = 0;
+    /// bytes reserved in those slabs
+    size_t bytes_reserved = 0;
+    /// blocks taken from the pool by the calling thread and by threads that have exited
+    size_t allocations = 0;
+    /// blocks given back to the pool by the calling thread and by threads that have exited
+    size_t deallocations = 0;
+    /// requests too large for the pool, which were passed on to operator new
+    size_t oversized = 0;
+  };
+
+  namespace detail
+  {
+    class Pool
+    {
+      public:
+        /// blocks are a multiple of this size, which is also their alignment
+        static const size_t granularity = 16;
+        static const size_t num_classes = 16;
+        static const size_t max_size = granularity * num_classes;
+        static const size_t slab_size = 64 * 1024;
+
+        static void *allocate(const size_t t_size, const size_t t_align)
+        {
+          Cache *c = cache();
+          if (t_size > max_size || t_align > granularity) {
+            if (c) { ++c->counters.oversized; }
+            return ::operator new(t_size);
+          }
+
+          const size_t idx = size_class(t_size);
+          if (!c) {
+            return allocate_shared_block(idx);
+          }
+
+          if (!c->lists.heads[idx]) {
+            refill(*c, idx);
+          }
+
+          ++c->counters.allocations;
+          return c->lists.pop(idx);
+        }
+
+        static void deallocate(void *t_ptr, const size_t t_size, const size_t t_align) noexcept
+        {
+          if (t_size > max_size || t_align > granularity) {
+            ::operator delete(t_ptr);
+            return;
+          }
+
+          const size_t idx = size_class(t_size);
+          Cache *c = cache();
+          if (!c) {
+            auto &d = depot();
+            Lock l(d.mutex);
+            d.lists.push(idx, t_ptr);
+            return;
+          }
+
+          c->lists.push(idx, t_ptr);
+          ++c->counters.deallocations;
+
+          // blocks freed by a thread other than the one that allocated them would pile up here
+          if (c->lists.free[idx] > 2 * blocks_per_slab(idx)) {
+            release(*c, idx, blocks_per_slab(idx));
+          }
+        }
+
+        static Pool_Statistics statistics()
+        {
+          auto &d = depot();
+          Pool_Statistics stats;
+          {
+            Lock l(d.mutex);
+            stats = d.retired;
+            stats.slabs = d.slabs.size();
+          }
+          stats.bytes_reserved = stats.slabs * slab_size;
+
+          if (const Cache *c = cache()) {
+            stats.allocations += c->counters.allocations;
+            stats.deallocations += c->counters.deallocations;
+            stats.oversized += c->counters.oversized;
+          }
+          return stats;
+        }
+
+      private:
+        // chaiscript_threading.hpp cannot be used, chaiscript_defines.hpp includes this file
+#ifndef CHAISCRIPT_NO_THREADS
+        typedef std::mutex Mutex;
+        typedef std::lock_guard<std::mutex> Lock;
+#else
+        struct Mutex {};
+        struct Lock
+        {
+          explicit Lock(Mutex &) {}
+        };
+#endif
+
+        struct Block
+        {
+          Block *next;
+        };
+
+        /// A free list for each size class
+        struct Free_Lists
+        {
+          std::array<Block *, num_classes> heads{};
+          std::array<size_t, num_classes> free{};
+
+          void push(const size_t t_idx, void *t_ptr)
+          {
+            auto *block = static_cast<Block *>(t_ptr);
+            block->next = heads[t_idx];
+            heads[t_idx] = block;
+            ++free[t_idx];
+          }
+
+          void *pop(const size_t t_idx)
+          {
+            Block *block = heads[t_idx];
+            heads[t_idx] = block->next;
+            --free[t_idx];
+            return block;
+          }
+
+          /// moves up to t_count blocks to t_to
+          void move(const size_t t_idx, const size_t t_count, Free_Lists &t_to)
+          {
+            for (size_t i = 0; i < t_count && heads[t_idx]; ++i) {
+              t_to.push(t_idx, pop(t_idx));
+            }
+          }
+        };
+
+        /// Slabs and the free blocks that threads gave back
+        struct Depot
+        {
+          Mutex mutex;
+          Free_Lists lists;
+          std::vector<std::unique_ptr<char[]>> slabs;
+          /// counters of the threads that have exited
+          Pool_Statistics retired;
+        };
+
+        /// The free lists of one thread
+        struct Cache
+        {
+          Free_Lists lists;
+          Pool_Statistics counters;
+
+          Cache() = default;
+          Cache(const Cache &) = delete;
+          Cache &operator=(const Cache &) = delete;
+
+          ~Cache()
+          {
+            auto &d = depot();
+            Lock l(d.mutex);
+            for (size_t idx = 0; idx < num_classes; ++idx) {
+              lists.move(idx, lists.free[idx], d.lists);
+            }
+            d.retired.allocations += counters.allocations;
+            d.retired.deallocations += counters.deallocations;
+            d.retired.oversized += counters.oversized;
+            destroyed() = true;
+          }
+        };
+
+        static size_t size_class(const size_t t_size)
+        {
+          return t_size == 0 ? 0 : (t_size - 1) / granularity;
+        }
+
+        static size_t blocks_per_slab(const size_t t_idx)
+        {
+          return slab_size / ((t_idx + 1) * granularity);
+        }
+
+        /// The depot is never destroyed, blocks can still be freed during static destruction
+        static Depot &depot()
+        {
+          static Depot *d = new Depot();
+          return *d;
+        }
+
+        /// \returns the calling thread's free lists, or null once they have been destroyed
+        static Cache *cache()
+        {
+          if (destroyed()) {
+            return nullptr;
+          }
+#ifndef CHAISCRIPT_NO_THREADS
+          thread_local static Cache c;
+#else
+          static Cache c;
+#endif
+          return &c;
+        }
+
+        /// set when the calling thread's Cache is destroyed, it has no destructor of its own
+        static bool &destroyed()
+        {
+#ifndef CHAISCRIPT_NO_THREADS
+          thread_local static bool d = false;
+#else
+          static bool d = false;
+#endif
+          return d;
+        }
+
+        /// Reserves a new slab and adds its blocks to t_lists. The depot must be locked
+        static void add_slab(Depot &t_depot, const size_t t_idx, Free_Lists &t_lists)
+        {
+          t_depot.slabs.emplace_back(new char[slab_size]);
+          const size_t block_size = (t_idx + 1) * granularity;
+          const size_t count = blocks_per_slab(t_idx);
+          for (size_t i = 0; i < count; ++i) {
+            t_lists.push(t_idx, t_depot.slabs.back().get() + i * block_size);
+          }
+        }
+
+        /// Takes a slab's worth of blocks from the depot, reserving a new slab if it has none
+        static void refill(Cache &t_cache, const size_t t_idx)
+        {
+          auto &d = depot();
+          Lock l(d.mutex);
+          if (d.lists.heads[t_idx]) {
+            d.lists.move(t_idx, blocks_per_slab(t_idx), t_cache.lists);
+          } else {
+            add_slab(d, t_idx, t_cache.lists);
+          }
+        }
+
+        /// Used once the calling thread's Cache has been destroyed
+        static void *allocate_shared_block(const size_t t_idx)
+        {
+          auto &d = depot();
+          Lock l(d.mutex);
+          if (!d.lists.heads[t_idx]) {
+            add_slab(d, t_idx, d.lists);
+          }
+          return d.lists.pop(t_idx);
+        }
+
+        /// Hands t_count free blocks of a thread back to the depot
+        static void release(Cache &t_cache, const size_t t_idx, const size_t t_count)
+        {
+          auto &d = depot();
+          Lock l(d.mutex);
+          t_cache.lists.move(t_idx, t_count, d.lists);
+        }
+    };
+
+    /// Standard allocator taking its memory from the Pool
+    template<typename T>
+      class Pool_Allocator
+      {
+        public:
+          typedef T value_type;
+
+          Pool_Allocator() = default;
+
+          template<typename U>
+            Pool_Allocator(const Pool_Allocator<U> &) noexcept
+            {
+            }
+
+          T *allocate(const size_t n)
+          {
+            return static_cast<T *>(Pool::allocate(n * sizeof(T), alignof(T)));
+          }
+
+          void deallocate(T *p, const size_t n) noexcept
+          {
+            Pool::deallocate(p, n * sizeof(T), alignof(T));
+          }
+
+          template<typename U>
+            bool operator==(const Pool_Allocator<U> &) const noexcept
+            {
+              return true;
+            }
+
+          template<typename U>
+            bool operator!=(const Pool_Allocator<U> &) const noexcept
+            {
+              return false;
+            }
+      };
+  }
+
+  /// \returns the counters of the pool allocator used when CHAISCRIPT_POOL_ALLOCATOR is defined
+  inline Pool_Statistics pool_statistics()
+  {
+    return detail::Pool::statistics();
+  }
+}
+
+#endif
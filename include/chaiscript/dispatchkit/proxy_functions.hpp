@@ -9,21 +9,27 @@
 #define CHAISCRIPT_PROXY_FUNCTIONS_HPP_
 
 
+#include <array>
+#include <atomic>
 #include <cassert>
 #include <functional>
 #include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <utility>
 #include <vector>
 #include <iterator>
 
 #include "../chaiscript_defines.hpp"
+#include "../chaiscript_threading.hpp"
 #include "boxed_cast.hpp"
 #include "boxed_value.hpp"
 #include "proxy_functions_detail.hpp"
 #include "type_info.hpp"
 #include "dynamic_object.hpp"
+#include "function_params.hpp"
+#include "inline_cache.hpp"
 
 namespace chaiscript {
 class Type_Conversions;
@@ -45,6 +51,8 @@ namespace chaiscript
     template<typename FunctionType>
       std::function<FunctionType> functor(std::shared_ptr<const Proxy_Function_Base> func, const Type_Conversions_State *t_conversions);
 
+    class Dispatch_Cache;
+
     class Param_Types
     {
       public:
@@ -72,8 +80,9 @@ namespace chaiscript
           return m_types == t_rhs.m_types;
         }
 
-        std::vector<Boxed_Value> convert(std::vector<Boxed_Value> vals, const Type_Conversions_State &t_conversions) const
+        std::vector<Boxed_Value> convert(const Function_Params &t_params, const Type_Conversions_State &t_conversions) const
         {
+          auto vals = t_params.to_vector();
           for (size_t i = 0; i < vals.size(); ++i)
           {
             const auto &name = m_types[i].first;
@@ -111,7 +120,7 @@ namespace chaiscript
 
         // first result: is a match
         // second result: needs conversions
-        std::pair<bool, bool> match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        std::pair<bool, bool> match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           bool needs_conversion = false;
 
@@ -194,7 +203,7 @@ namespace chaiscript
       public:
         virtual ~Proxy_Function_Base() = default;
 
-        Boxed_Value operator()(const std::vector<Boxed_Value> &params, const chaiscript::Type_Conversions_State &t_conversions) const
+        Boxed_Value operator()(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions) const
         {
           if (m_arity < 0 || size_t(m_arity) == params.size()) {
             return do_call(params, t_conversions);
@@ -203,6 +212,30 @@ namespace chaiscript
           }
         }
 
+        Boxed_Value operator()(const std::vector<Boxed_Value> &params, const chaiscript::Type_Conversions_State &t_conversions) const
+        {
+          return (*this)(Function_Params(params), t_conversions);
+        }
+
+        /// Calls the function if params match it, used to probe the candidates of an overload set.
+        /// \returns false instead of throwing if the arity or the type of a parameter does not
+        ///          match or a guard rejects the call. Errors raised by the call itself are thrown
+        bool try_call(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions, Boxed_Value &t_result) const
+        {
+          if (m_arity < 0 || size_t(m_arity) == params.size()) {
+            return do_try_call(params, t_conversions, t_result);
+          } else {
+            return false;
+          }
+        }
+
+        /// Calls the function, an overload set uses t_cache to remember which of its
+        /// functions was chosen for the types of params
+        virtual Boxed_Value call(const Function_Params &params, const chaiscript::Type_Conversions_State &t_conversions, Dispatch_Cache &) const
+        {
+          return (*this)(params, t_conversions);
+        }
+
         /// Returns a vector containing all of the types of the parameters the function returns/takes
         /// if the function is variadic or takes no arguments (arity of 0 or -1), the returned
         /// value contains exactly 1 Type_Info object: the return type
@@ -210,7 +243,12 @@ namespace chaiscript
         const std::vector<Type_Info> &get_param_types() const { return m_types; }
 
         virtual bool operator==(const Proxy_Function_Base &) const = 0;
-        virtual bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const = 0;
+        virtual bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const = 0;
+
+        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        {
+          return call_match(Function_Params(vals), t_conversions);
+        }
 
         virtual bool is_attribute_function() const { return false; }
 
@@ -226,7 +264,7 @@ namespace chaiscript
 
         //! Return true if the function is a possible match
         //! to the passed in values
-        bool filter(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        bool filter(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           assert(m_arity == -1 || (m_arity > 0 && static_cast<int>(vals.size()) == m_arity));
 
@@ -271,7 +309,14 @@ namespace chaiscript
         }
 
       protected:
-        virtual Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const = 0;
+        virtual Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const = 0;
+
+        /// Implementations that can check their parameters without calling override this
+        virtual bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const
+        {
+          t_result = do_call(params, t_conversions);
+          return true;
+        }
 
         Proxy_Function_Base(std::vector<Type_Info> t_types, int t_arity)
           : m_types(std::move(t_types)), m_arity(t_arity), m_has_arithmetic_param(false)
@@ -288,7 +333,7 @@ namespace chaiscript
         }
 
 
-        static bool compare_types(const std::vector<Type_Info> &tis, const std::vector<Boxed_Value> &bvs, 
+        static bool compare_types(const std::vector<Type_Info> &tis, const Function_Params &bvs, 
                                   const Type_Conversions_State &t_conversions)
         {
           if (tis.size() - 1 != bvs.size())
@@ -365,7 +410,7 @@ namespace chaiscript
                 && this->m_param_types == prhs->m_param_types);
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return call_match_internal(vals, t_conversions).first;
         }
@@ -383,12 +428,13 @@ namespace chaiscript
 
 
       protected:
-        bool test_guard(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const
+        bool test_guard(const Function_Params &params, const Type_Conversions_State &t_conversions) const
         {
           if (m_guard)
           {
             try {
-              return boxed_cast<bool>((*m_guard)(params, t_conversions));
+              Boxed_Value result;
+              return m_guard->try_call(params, t_conversions, result) && boxed_cast<bool>(result);
             } catch (const exception::arity_error &) {
               return false;
             } catch (const exception::bad_boxed_cast &) {
@@ -401,7 +447,7 @@ namespace chaiscript
 
         // first result: is a match
         // second result: needs conversions
-        std::pair<bool, bool> call_match_internal(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const
+        std::pair<bool, bool> call_match_internal(const Function_Params &vals, const Type_Conversions_State &t_conversions) const
         {
           const auto comparison_result = [&](){
             if (m_arity < 0) {
@@ -447,6 +493,36 @@ namespace chaiscript
 
 
 
+    namespace detail
+    {
+      /// true if a Dynamic_Proxy_Function_Impl's callable also takes the conversions of the call
+      template<typename Callable, typename = void>
+        struct Takes_Conversions : std::false_type
+        {
+        };
+
+      template<typename Callable>
+        struct Takes_Conversions<Callable, decltype(void(std::declval<const Callable &>()(
+                std::declval<const Function_Params &>(), std::declval<const Type_Conversions_State &>())))>
+        : std::true_type
+        {
+        };
+
+      /// true if a Dynamic_Proxy_Function_Impl's callable takes Function_Params, otherwise
+      /// it takes the parameters as a std::vector<Boxed_Value>
+      template<typename Callable, typename = void>
+        struct Takes_Function_Params : std::false_type
+        {
+        };
+
+      template<typename Callable>
+        struct Takes_Function_Params<Callable, decltype(void(std::declval<const Callable &>()(
+                std::declval<const Function_Params &>())))>
+        : std::true_type
+        {
+        };
+    }
+
     template<typename Callable>
     class Dynamic_Proxy_Function_Impl final : public Dynamic_Proxy_Function
     {
@@ -469,22 +545,56 @@ namespace chaiscript
 
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           const auto match_results = call_match_internal(params, t_conversions);
           if (match_results.first)
           {
             if (match_results.second) {
-              return m_f(m_param_types.convert(params, t_conversions));
+              return call_f(Function_Params(m_param_types.convert(params, t_conversions)), t_conversions);
             } else {
-              return m_f(params);
+              return call_f(params, t_conversions);
             }
           } else {
             throw exception::guard_error();
           }
         }
 
+        bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+        {
+          const auto match_results = call_match_internal(params, t_conversions);
+          if (!match_results.first) {
+            return false;
+          } else if (match_results.second) {
+            t_result = call_f(Function_Params(m_param_types.convert(params, t_conversions)), t_conversions);
+          } else {
+            t_result = call_f(params, t_conversions);
+          }
+          return true;
+        }
+
       private:
+        Boxed_Value call_f(const Function_Params &params, const Type_Conversions_State &t_conversions) const
+        {
+          return call_f(params, t_conversions, detail::Takes_Conversions<Callable>(), detail::Takes_Function_Params<Callable>());
+        }
+
+        template<typename Takes_Params>
+        Boxed_Value call_f(const Function_Params &params, const Type_Conversions_State &t_conversions, std::true_type, Takes_Params) const
+        {
+          return m_f(params, t_conversions);
+        }
+
+        Boxed_Value call_f(const Function_Params &params, const Type_Conversions_State &, std::false_type, std::true_type) const
+        {
+          return m_f(params);
+        }
+
+        Boxed_Value call_f(const Function_Params &params, const Type_Conversions_State &, std::false_type, std::false_type) const
+        {
+          return m_f(params.to_vector());
+        }
+
         Callable m_f;
     };
 
@@ -522,9 +632,11 @@ namespace chaiscript
         }
 
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
-          return m_f->call_match(build_param_list(vals), t_conversions);
+          Param_List args;
+          build_param_list(vals, args);
+          return m_f->call_match(args, t_conversions);
         }
 
         std::vector<Const_Proxy_Function> get_contained_functions() const override
@@ -533,13 +645,11 @@ namespace chaiscript
         }
 
 
-        std::vector<Boxed_Value> build_param_list(const std::vector<Boxed_Value> &params) const
+        void build_param_list(const Function_Params &params, Param_List &args) const
         {
           auto parg = params.begin();
           auto barg = m_args.begin();
 
-          std::vector<Boxed_Value> args;
-
           while (!(parg == params.end() && barg == m_args.end()))
           {
             while (barg != m_args.end() 
@@ -561,7 +671,6 @@ namespace chaiscript
               ++barg;
             } 
           }
-          return args;
         }
 
 
@@ -590,9 +699,18 @@ namespace chaiscript
           return retval;
         }
 
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
+        {
+          Param_List args;
+          build_param_list(params, args);
+          return (*m_f)(args, t_conversions);
+        }
+
+        bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
         {
-          return (*m_f)(build_param_list(params), t_conversions);
+          Param_List args;
+          build_param_list(params, args);
+          return m_f->try_call(args, t_conversions, t_result);
         }
 
       private:
@@ -608,13 +726,24 @@ namespace chaiscript
         {
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return static_cast<int>(vals.size()) == get_arity() 
             && (compare_types(m_types, vals, t_conversions) && compare_types_with_cast(vals, t_conversions));
         }
 
-        virtual bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const = 0;
+        virtual bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const = 0;
+
+      protected:
+        bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+        {
+          if (!compare_types_with_cast(params, t_conversions)) {
+            return false;
+          }
+
+          t_result = do_call(params, t_conversions);
+          return true;
+        }
     };
 
 
@@ -630,7 +759,7 @@ namespace chaiscript
         {
         }
 
-        bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return detail::compare_types_cast(static_cast<Func *>(nullptr), vals, t_conversions);
         }
@@ -642,7 +771,7 @@ namespace chaiscript
 
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return detail::call_func(detail::Function_Signature<Func>(), m_f, params, t_conversions);
         }
@@ -674,7 +803,7 @@ namespace chaiscript
           assert(!m_shared_ptr_holder || m_shared_ptr_holder.get() == &m_f.get());
         }
 
-        bool compare_types_with_cast(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &t_conversions) const override
+        bool compare_types_with_cast(const Function_Params &vals, const Type_Conversions_State &t_conversions) const override
         {
           return detail::compare_types_cast(static_cast<Func *>(nullptr), vals, t_conversions);
         }
@@ -694,7 +823,7 @@ namespace chaiscript
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           return detail::call_func(detail::Function_Signature<Func>(), m_f.get(), params, t_conversions);
         }
@@ -731,7 +860,7 @@ namespace chaiscript
           }
         }
 
-        bool call_match(const std::vector<Boxed_Value> &vals, const Type_Conversions_State &) const override
+        bool call_match(const Function_Params &vals, const Type_Conversions_State &) const override
         {
           if (vals.size() != 1)
           {
@@ -742,7 +871,7 @@ namespace chaiscript
         }
 
       protected:
-        Boxed_Value do_call(const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions) const override
+        Boxed_Value do_call(const Function_Params &params, const Type_Conversions_State &t_conversions) const override
         {
           const Boxed_Value &bv = params[0];
           if (bv.is_const())
@@ -755,6 +884,16 @@ namespace chaiscript
           }
         }
 
+        bool do_try_call(const Function_Params &params, const Type_Conversions_State &t_conversions, Boxed_Value &t_result) const override
+        {
+          if (params[0].is_const() ? !can_boxed_cast<const Class *>(params[0], &t_conversions) : !can_boxed_cast<Class *>(params[0], &t_conversions)) {
+            return false;
+          }
+
+          t_result = do_call(params, t_conversions);
+          return true;
+        }
+
       private:
         template<typename Type>
         auto do_call_impl(Class *o) const -> std::enable_if_t<std::is_pointer<Type>::value, Boxed_Value>
@@ -828,7 +967,7 @@ namespace chaiscript
     namespace detail 
     {
       template<typename FuncType>
-        bool types_match_except_for_arithmetic(const FuncType &t_func, const std::vector<Boxed_Value> &plist,
+        bool types_match_except_for_arithmetic(const FuncType &t_func, const Function_Params &plist,
             const Type_Conversions_State &t_conversions)
         {
           const std::vector<Type_Info> &types = t_func->get_param_types();
@@ -847,7 +986,7 @@ namespace chaiscript
         }
 
       template<typename InItr, typename Funcs>
-        Boxed_Value dispatch_with_conversions(InItr begin, const InItr &end, const std::vector<Boxed_Value> &plist, 
+        Boxed_Value dispatch_with_conversions(InItr begin, const InItr &end, const Function_Params &plist, 
             const Type_Conversions_State &t_conversions, const Funcs &t_funcs)
         {
           InItr matching_func(end);
@@ -870,7 +1009,7 @@ namespace chaiscript
                   // keep the old one, it has a better const/non-const matchup
                 } else {
                   // ambiguous function call
-                  throw exception::dispatch_error(plist, std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
+                  throw exception::dispatch_error(plist.to_vector(), std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
                 }
               }
             }
@@ -881,29 +1020,31 @@ namespace chaiscript
           if (matching_func == end)
           {
             // no appropriate function to attempt arithmetic type conversion on
-            throw exception::dispatch_error(plist, std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
+            throw exception::dispatch_error(plist.to_vector(), std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
           }
 
 
-          std::vector<Boxed_Value> newplist;
+          Param_List newplist;
           newplist.reserve(plist.size());
 
           const std::vector<Type_Info> &tis = matching_func->second->get_param_types();
-          std::transform(tis.begin() + 1, tis.end(),
-                         plist.begin(),
-                         std::back_inserter(newplist),
-                         [](const Type_Info &ti, const Boxed_Value &param) -> Boxed_Value {
-                           if (ti.is_arithmetic() && param.get_type_info().is_arithmetic()
-                               && param.get_type_info() != ti) {
-                             return Boxed_Number(param).get_as(ti).bv;
-                           } else {
-                             return param;
-                           }
-                         }
-                       );
+          for (size_t i = 0; i < plist.size(); ++i)
+          {
+            const auto &ti = tis[i + 1];
+            const auto &param = plist[i];
+            if (ti.is_arithmetic() && param.get_type_info().is_arithmetic()
+                && param.get_type_info() != ti) {
+              newplist.push_back(Boxed_Number(param).get_as(ti).bv);
+            } else {
+              newplist.push_back(param);
+            }
+          }
 
           try {
-            return (*(matching_func->second))(newplist, t_conversions);
+            Boxed_Value retval;
+            if (matching_func->second->try_call(newplist, t_conversions, retval)) {
+              return retval;
+            }
           } catch (const exception::bad_boxed_cast &) {
             //parameter failed to cast
           } catch (const exception::arity_error &) {
@@ -912,17 +1053,90 @@ namespace chaiscript
             //guard failed to allow the function to execute
           }
 
-          throw exception::dispatch_error(plist, std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
+          throw exception::dispatch_error(plist.to_vector(), std::vector<Const_Proxy_Function>(t_funcs.begin(), t_funcs.end()));
 
         }
     }
 
-    /// Take a vector of functions and a vector of parameters. Attempt to execute
-    /// each function against the set of parameters, in order, until a matching
-    /// function is found or throw dispatch_error if no matching function is found
-    template<typename Funcs>
-      Boxed_Value dispatch(const Funcs &funcs,
-          const std::vector<Boxed_Value> &plist, const Type_Conversions_State &t_conversions)
+    /// Remembers which function of an overload set a call site dispatched to for a list
+    /// of argument types, so that later calls with the same types skip overload resolution.
+    ///
+    /// Entries are keyed on the identity of the overload set. Sets are never modified in
+    /// place, Dispatch_Engine::add_function replaces them, so any change to a set
+    /// invalidates the entries made for it. Entries only hold the set weakly, a set can
+    /// contain the function whose body owns the cache. An entry whose set is gone, such
+    /// as one of an engine that was destroyed, is the first to be replaced, see
+    /// chaiscript::detail::Inline_Cache.
+    class Dispatch_Cache
+    {
+      public:
+        const Proxy_Function_Base *find(const void *t_funcs, const Function_Params &t_params, const Type_Conversions_State &t_conversions) const
+        {
+          return m_entries.find([&](const Entry &t_entry) {
+              return t_entry.matches(t_funcs, t_params, t_conversions) ? t_entry.func : nullptr;
+            });
+        }
+
+        void add(const std::shared_ptr<const void> &t_funcs, const Function_Params &t_params, const Type_Conversions_State &t_conversions,
+            const Proxy_Function_Base *t_func)
+        {
+          // functions taking script defined classes are chosen by the class name
+          // of the value, which is not part of its type
+          if (std::any_of(t_params.begin(), t_params.end(),
+                [](const Boxed_Value &t_param) { return t_param.get_type_info().bare_equal(user_type<Dynamic_Object>()); })) {
+            return;
+          }
+
+          std::vector<Type_Info> types;
+          types.reserve(t_params.size());
+          for (const auto &param : t_params) {
+            types.push_back(param.get_type_info());
+          }
+
+          m_entries.add(std::make_unique<const Entry>(Entry{t_funcs, t_funcs.get(), t_conversions.get(), t_conversions->num_conversions(), std::move(types), t_func}),
+              [](const Entry &t_entry) { return t_entry.funcs.expired(); });
+        }
+
+      private:
+        struct Entry
+        {
+          std::weak_ptr<const void> funcs;
+          const void *funcs_address;
+          const Type_Conversions *conversions;
+          size_t num_conversions;
+          std::vector<Type_Info> types;
+          const Proxy_Function_Base *func;
+
+          bool matches(const void *t_funcs, const Function_Params &t_params, const Type_Conversions_State &t_conversions) const
+          {
+            // the caller holds t_funcs, a live set at the same address is the same set
+            if (funcs_address != t_funcs || funcs.expired() || conversions != t_conversions.get()
+                || num_conversions != t_conversions->num_conversions() || types.size() != t_params.size()) {
+              return false;
+            }
+
+            for (size_t i = 0; i < types.size(); ++i) {
+              const auto &ti = t_params[i].get_type_info();
+              if (!(types[i] == ti) || types[i].is_const() != ti.is_const() || types[i].is_undef() != ti.is_undef()) {
+                return false;
+              }
+            }
+
+            return true;
+          }
+        };
+
+        chaiscript::detail::Inline_Cache<Entry> m_entries;
+    };
+
+    namespace detail
+    {
+      /// Implements dispatch. t_skip is a function that already failed for plist, if the
+      /// call succeeds t_chosen is set to the function called as long as no earlier
+      /// candidate was rejected by a failed call, which could depend on the values.
+      template<typename Funcs>
+        Boxed_Value dispatch(const Funcs &funcs, const Function_Params &plist, const Type_Conversions_State &t_conversions,
+            const Proxy_Function_Base *t_skip, const Proxy_Function_Base **t_chosen)
       {
         std::vector<std::pair<size_t, const Proxy_Function_Base *>> ordered_funcs;
         ordered_funcs.reserve(funcs.size());
@@ -948,28 +1162,79 @@ namespace chaiscript
         }
 
 
+        bool value_dependent = t_skip != nullptr;
+
         for (size_t i = 0; i <= plist.size(); ++i)
         {
           for (const auto &func : ordered_funcs )
           {
             try {
-              if (func.first == i && (i == 0 || func.second->filter(plist, t_conversions)))
+              if (func.first == i && func.second != t_skip && (i == 0 || func.second->filter(plist, t_conversions)))
               {
-                return (*(func.second))(plist, t_conversions);
+                Boxed_Value retval;
+                if (func.second->try_call(plist, t_conversions, retval)) {
+                  if (t_chosen && !value_dependent) {
+                    *t_chosen = func.second;
+                  }
+                  return retval;
+                }
+                // a function can be rejected by value, by a guard for instance
+                value_dependent = true;
               }
             } catch (const exception::bad_boxed_cast &) {
               //parameter failed to cast, try again
+              value_dependent = true;
             } catch (const exception::arity_error &) {
               //invalid num params, try again
+              value_dependent = true;
             } catch (const exception::guard_error &) {
               //guard failed to allow the function to execute,
               //try again
+              value_dependent = true;
             }
           }
         }
 
         return detail::dispatch_with_conversions(ordered_funcs.cbegin(), ordered_funcs.cend(), plist, t_conversions, funcs);
       }
+    }
+
+    /// Take a vector of functions and a vector of parameters. Attempt to execute
+    /// each function against the set of parameters, in order, until a matching
+    /// function is found or throw dispatch_error if no matching function is found
+    template<typename Funcs>
+      Boxed_Value dispatch(const Funcs &funcs,
+          const Function_Params &plist, const Type_Conversions_State &t_conversions)
+      {
+        return detail::dispatch(funcs, plist, t_conversions, nullptr, nullptr);
+      }
+
+    /// Dispatch that first tries the function t_cache remembers for the types of plist,
+    /// t_funcs must own funcs
+    template<typename Funcs>
+      Boxed_Value dispatch(const std::shared_ptr<Funcs> &t_funcs,
+          const Function_Params &plist, const Type_Conversions_State &t_conversions, Dispatch_Cache &t_cache)
+      {
+        const auto cached = t_cache.find(t_funcs.get(), plist, t_conversions);
+        if (cached) {
+          try {
+            Boxed_Value retval;
+            if (cached->try_call(plist, t_conversions, retval)) {
+              return retval;
+            }
+          } catch (const exception::bad_boxed_cast &) {
+          } catch (const exception::arity_error &) {
+          } catch (const exception::guard_error &) {
+          }
+        }
+
+        const Proxy_Function_Base *chosen = nullptr;
+        auto retval = detail::dispatch(*t_funcs, plist, t_conversions, cached, &chosen);
+        if (chosen) {
+          t_cache.add(t_funcs, plist, t_conversions, chosen);
+        }
+        return retval;
+      }
   }
 }
 
@@ -18,6 +18,7 @@
 #include "handle_return.hpp"
 #include "type_info.hpp"
 #include "callable_traits.hpp"
+#include "function_params.hpp"
 
 namespace chaiscript {
 class Type_Conversions_State;
@@ -68,31 +69,33 @@ namespace chaiscript
 
 
       /**
-       * Used by Proxy_Function_Impl to determine if it is equivalent to another
-       * Proxy_Function_Impl object. This function is primarily used to prevent
-       * registration of two functions with the exact same signatures
+       * Used by Proxy_Function_Impl to determine if each of params can be
+       * cast to the type of the parameter it is passed to. Does not throw
+       * on a mismatch, overload resolution relies on this to probe candidates
        */
+      template<typename Ret, typename ... Params, size_t ... I>
+        bool compare_types_cast(Ret (*)(Params...), std::index_sequence<I...>,
+             const Function_Params &params, const Type_Conversions_State &t_conversions)
+        {
+          (void)params; (void)t_conversions;
+          bool possible = true;
+          // this is ok because the order of evaluation of initializer lists is well defined
+          (void)std::initializer_list<int>{(possible = possible && can_boxed_cast<Params>(params[I], &t_conversions), 0)...};
+          return possible;
+        }
+
       template<typename Ret, typename ... Params>
-        bool compare_types_cast(Ret (*)(Params...),
-             const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+        bool compare_types_cast(Ret (*f)(Params...),
+             const Function_Params &params, const Type_Conversions_State &t_conversions)
         {
-          try {
-            std::vector<Boxed_Value>::size_type i = 0;
-            (void)i;
-            (void)params; (void)t_conversions;
-            // this is ok because the order of evaluation of initializer lists is well defined
-            (void)std::initializer_list<int>{(boxed_cast<Params>(params[i++], &t_conversions), 0)...};
-            return true;
-          } catch (const exception::bad_boxed_cast &) {
-            return false;
-          }
+          return compare_types_cast(f, std::index_sequence_for<Params...>{}, params, t_conversions);
         }
 
 
       template<typename Callable, typename Ret, typename ... Params, size_t ... I>
         Ret call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &, 
                       std::index_sequence<I...>, const Callable &f,
-                      const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+                      const Function_Params &params, const Type_Conversions_State &t_conversions)
         {
           (void)params; (void)t_conversions;
           return f(boxed_cast<Params>(params[I], &t_conversions)...);
@@ -105,14 +108,14 @@ namespace chaiscript
       /// the bad_boxed_cast is passed up to the caller.
       template<typename Callable, typename Ret, typename ... Params>
         Boxed_Value call_func(const chaiscript::dispatch::detail::Function_Signature<Ret (Params...)> &sig, const Callable &f,
-            const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+            const Function_Params &params, const Type_Conversions_State &t_conversions)
         {
           return Handle_Return<Ret>::handle(call_func(sig, std::index_sequence_for<Params...>{}, f, params, t_conversions));
         }
 
       template<typename Callable, typename ... Params>
         Boxed_Value call_func(const chaiscript::dispatch::detail::Function_Signature<void (Params...)> &sig, const Callable &f,
-            const std::vector<Boxed_Value> &params, const Type_Conversions_State &t_conversions)
+            const Function_Params &params, const Type_Conversions_State &t_conversions)
         {
           call_func(sig, std::index_sequence_for<Params...>{}, f, params, t_conversions);
 #ifdef CHAISCRIPT_MSVC
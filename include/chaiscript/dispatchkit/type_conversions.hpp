@@ -7,6 +7,7 @@
 #ifndef CHAISCRIPT_DYNAMIC_CAST_CONVERSION_HPP_
 #define CHAISCRIPT_DYNAMIC_CAST_CONVERSION_HPP_
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <set>
@@ -14,6 +15,9 @@
 #include <string>
 #include <type_traits>
 #include <typeinfo>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "../chaiscript_threading.hpp"
 #include "bad_boxed_cast.hpp"
@@ -23,6 +27,11 @@
 
 namespace chaiscript
 {
+  namespace detail
+  {
+    class Dispatch_Engine;
+  }
+
   namespace exception
   {
     class bad_boxed_dynamic_cast : public bad_boxed_cast
@@ -97,6 +106,13 @@ namespace chaiscript
           return true;
         }
 
+        /// \returns true if the converted value refers to the value it was converted from,
+        /// which makes it safe to convert it further
+        virtual bool chainable() const
+        {
+          return false;
+        }
+
         virtual ~Type_Conversion_Base() = default;
 
       protected:
@@ -251,6 +267,11 @@ namespace chaiscript
         {
           return Static_Caster<Derived, Base>::cast(t_derived);
         }
+
+        bool chainable() const override
+        {
+          return true;
+        }
     };
 
     template<typename Base, typename Derived>
@@ -277,10 +298,61 @@ namespace chaiscript
         {
           return Static_Caster<Derived, Base>::cast(t_derived);
         }
+
+        bool chainable() const override
+        {
+          return true;
+        }
     };
 
 
 
+    /// Conversions applied one after the other, from a class to a base class of one of its
+    /// base classes
+    class Type_Conversion_Chain : public Type_Conversion_Base
+    {
+      public:
+        explicit Type_Conversion_Chain(std::vector<std::shared_ptr<Type_Conversion_Base>> t_steps)
+          : Type_Conversion_Base(t_steps.back()->to(), t_steps.front()->from()),
+            m_steps(std::move(t_steps))
+        {
+        }
+
+        Boxed_Value convert(const Boxed_Value &t_from) const override
+        {
+          Boxed_Value ret = t_from;
+          for (const auto &step : m_steps)
+          {
+            ret = step->convert(ret);
+          }
+          return ret;
+        }
+
+        Boxed_Value convert_down(const Boxed_Value &t_to) const override
+        {
+          Boxed_Value ret = t_to;
+          for (auto step = m_steps.rbegin(); step != m_steps.rend(); ++step)
+          {
+            ret = (*step)->convert_down(ret);
+          }
+          return ret;
+        }
+
+        bool bidir() const override
+        {
+          return std::all_of(m_steps.begin(), m_steps.end(),
+              [](const std::shared_ptr<Type_Conversion_Base> &t_step) { return t_step->bidir(); });
+        }
+
+        bool chainable() const override
+        {
+          return true;
+        }
+
+      private:
+        std::vector<std::shared_ptr<Type_Conversion_Base>> m_steps;
+    };
+
     template<typename Callable>
     class Type_Conversion_Impl : public Type_Conversion_Base
     {
@@ -322,20 +394,14 @@ namespace chaiscript
         std::vector<Boxed_Value> saves;
       };
 
-      struct Less_Than
-      {
-        bool operator()(const std::type_info *t_lhs, const std::type_info *t_rhs) const
-        {
-          return *t_lhs != *t_rhs && t_lhs->before(*t_rhs);
-        }
-      };
-
       Type_Conversions()
         : m_mutex(),
           m_conversions(),
           m_convertableTypes(),
           m_num_types(0),
+          m_num_conversions(0),
           m_thread_cache(this),
+          m_resolved_cache(this),
           m_conversion_saves(this)
       {
       }
@@ -344,22 +410,42 @@ namespace chaiscript
         : m_mutex(),
           m_conversions(t_other.get_conversions()),
           m_convertableTypes(t_other.m_convertableTypes),
-          m_num_types(m_conversions.size()),
+          m_num_types(t_other.m_num_types.load()),
+          m_num_conversions(m_conversions.size()),
           m_thread_cache(this),
+          m_resolved_cache(this),
           m_conversion_saves(this)
       {
+        for (const auto &conversion : m_conversions)
+        {
+          index(conversion);
+        }
+      }
+
+      /// \returns the engine these conversions belong to, null if they do not belong to one
+      chaiscript::detail::Dispatch_Engine *get_engine() const
+      {
+        return m_engine;
+      }
+
+      /// Called by the engine that owns the conversions, copies of them do not belong to it
+      void set_engine(chaiscript::detail::Dispatch_Engine *t_engine)
+      {
+        m_engine = t_engine;
       }
 
-      const std::set<const std::type_info *, Less_Than> &thread_cache() const
+      /// \returns the types that take part in a conversion, indexed by Type_Info::bare_id()
+      const std::vector<bool> &thread_cache() const
       {
         auto &cache = *m_thread_cache;
-        if (cache.size() != m_num_types)
+        if (cache.num_types != m_num_types)
         {
           chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-          cache = m_convertableTypes;
+          cache.types = m_convertableTypes;
+          cache.num_types = m_num_types;
         }
 
-        return cache;
+        return cache.types;
       }
 
       void add_conversion(const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
@@ -367,14 +453,29 @@ namespace chaiscript
         chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
         /// \todo error if a conversion already exists
         m_conversions.insert(conversion);
-        m_convertableTypes.insert({conversion->to().bare_type_info(), conversion->from().bare_type_info()});
-        m_num_types = m_convertableTypes.size();
+        index(conversion);
+        for (const auto id : {conversion->to().bare_id(), conversion->from().bare_id()}) {
+          if (id >= m_convertableTypes.size()) {
+            m_convertableTypes.resize(id + 1);
+          }
+          if (!m_convertableTypes[id]) {
+            m_convertableTypes[id] = true;
+            ++m_num_types;
+          }
+        }
+        ++m_num_conversions;
+      }
+
+      /// Number of conversions added, changes whenever a conversion is added
+      size_t num_conversions() const
+      {
+        return m_num_conversions;
       }
 
       template<typename T>
         bool convertable_type() const
         {
-          return thread_cache().count(user_type<T>().bare_type_info()) != 0;
+          return convertable(thread_cache(), user_type<T>().bare_id());
         }
 
       template<typename To, typename From>
@@ -386,7 +487,7 @@ namespace chaiscript
       bool converts(const Type_Info &to, const Type_Info &from) const
       {
         const auto &types = thread_cache();
-        if (types.count(to.bare_type_info()) != 0 && types.count(from.bare_type_info()) != 0)
+        if (convertable(types, to.bare_id()) && convertable(types, from.bare_id()))
         {
           return has_conversion(to, from);
         } else {
@@ -447,19 +548,19 @@ namespace chaiscript
 
       bool has_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-        return find_bidir(to, from) != m_conversions.end();
+        if (resolve(to, from)) {
+          return true;
+        }
+
+        const auto reverse = resolve(from, to);
+        return reverse && reverse->bidir();
       }
 
       std::shared_ptr<detail::Type_Conversion_Base> get_conversion(const Type_Info &to, const Type_Info &from) const
       {
-        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
-
-        const auto itr = find(to, from);
-
-        if (itr != m_conversions.end())
+        if (auto conversion = resolve(to, from))
         {
-          return *itr;
+          return conversion;
         } else {
           throw std::out_of_range("No such conversion exists from " + from.bare_name() + " to " + to.bare_name());
         }
@@ -470,27 +571,140 @@ namespace chaiscript
       }
 
     private:
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find_bidir(
-          const Type_Info &to, const Type_Info &from) const
+      static bool convertable(const std::vector<bool> &t_types, const uint32_t t_id)
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion) -> bool
-              {
-                return  (conversion->to().bare_equal(to) && conversion->from().bare_equal(from))
-                     || (conversion->bidir() && conversion->from().bare_equal(to) && conversion->to().bare_equal(from));
-              }
-        );
+        return t_id < t_types.size() && t_types[t_id];
+      }
+
+      /// (to, from) bare type ids
+      typedef std::pair<uint32_t, uint32_t> Type_Pair;
+
+      struct Type_Hash
+      {
+        size_t operator()(const Type_Pair &t_types) const
+        {
+          return std::hash<uint64_t>()((uint64_t(t_types.first) << 32) | t_types.second);
+        }
+      };
+
+      typedef std::unordered_map<Type_Pair, std::shared_ptr<detail::Type_Conversion_Base>, Type_Hash> Conversion_Map;
+
+      struct Convertable_Types
+      {
+        size_t num_types = 0;
+        std::vector<bool> types;
+      };
+
+      struct Resolved_Cache
+      {
+        size_t num_conversions = 0;
+        /// a null conversion records that there is none
+        std::unordered_map<Type_Pair, std::shared_ptr<detail::Type_Conversion_Base>, Type_Hash> conversions;
+      };
+
+      void index(const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
+      {
+        m_index[Type_Pair(conversion->to().bare_id(), conversion->from().bare_id())] = conversion;
+        if (conversion->chainable()) {
+          m_chainable.emplace(conversion->from().bare_id(), conversion);
+        }
+        m_chains.clear();
       }
 
-      std::set<std::shared_ptr<detail::Type_Conversion_Base> >::const_iterator find(
-          const Type_Info &to, const Type_Info &from) const
+      /// \returns the conversion from "from" to "to", or null if there is none
+      std::shared_ptr<detail::Type_Conversion_Base> resolve(const Type_Info &to, const Type_Info &from) const
       {
-        return std::find_if(m_conversions.begin(), m_conversions.end(),
-              [&to, &from](const std::shared_ptr<detail::Type_Conversion_Base> &conversion)
+        auto &cache = *m_resolved_cache;
+        const size_t num_conversions = m_num_conversions;
+        if (cache.num_conversions != num_conversions)
+        {
+          cache.conversions.clear();
+          cache.num_conversions = num_conversions;
+        }
+
+        const Type_Pair types(to.bare_id(), from.bare_id());
+        const auto itr = cache.conversions.find(types);
+        if (itr != cache.conversions.end())
+        {
+          return itr->second;
+        }
+
+        auto conversion = find(types);
+        cache.conversions.emplace(types, conversion);
+        return conversion;
+      }
+
+      std::shared_ptr<detail::Type_Conversion_Base> find(const Type_Pair &t_types) const
+      {
+        std::shared_ptr<detail::Type_Conversion_Base> chain;
+        size_t num_conversions = 0;
+        {
+          chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+
+          const auto direct = m_index.find(t_types);
+          if (direct != m_index.end())
+          {
+            return direct->second;
+          }
+
+          const auto memo = m_chains.find(t_types);
+          if (memo != m_chains.end())
+          {
+            return memo->second;
+          }
+
+          num_conversions = m_num_conversions;
+          chain = find_chain(t_types);
+        }
+
+        // only memoized if no conversion was added while the lock was let go, which would
+        // have cleared the memoized chains and may have made this one out of date
+        chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        if (num_conversions == m_num_conversions) {
+          m_chains.emplace(t_types, chain);
+        }
+        return chain;
+      }
+
+      /// Breadth first search for the shortest chain of chainable conversions from
+      /// t_types.second to t_types.first
+      std::shared_ptr<detail::Type_Conversion_Base> find_chain(const Type_Pair &t_types) const
+      {
+        // the conversion each type was first reached through
+        std::unordered_map<uint32_t, std::shared_ptr<detail::Type_Conversion_Base>> reached;
+        reached.emplace(t_types.second, nullptr);
+
+        std::vector<uint32_t> queue{t_types.second};
+
+        for (size_t i = 0; i < queue.size(); ++i)
+        {
+          const auto range = m_chainable.equal_range(queue[i]);
+          for (auto itr = range.first; itr != range.second; ++itr)
+          {
+            auto type = itr->second->to().bare_id();
+            if (!reached.emplace(type, itr->second).second) {
+              continue;
+            }
+
+            if (type == t_types.first)
+            {
+              std::vector<std::shared_ptr<detail::Type_Conversion_Base>> steps;
+              while (type != t_types.second)
               {
-                return conversion->to().bare_equal(to) && conversion->from().bare_equal(from);
+                const auto &step = reached.at(type);
+                steps.push_back(step);
+                type = step->from().bare_id();
               }
-        );
+
+              std::reverse(steps.begin(), steps.end());
+              return std::make_shared<detail::Type_Conversion_Chain>(std::move(steps));
+            }
+
+            queue.push_back(type);
+          }
+        }
+
+        return nullptr;
       }
 
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> get_conversions() const
@@ -504,10 +718,20 @@ namespace chaiscript
 
       mutable chaiscript::detail::threading::shared_mutex m_mutex;
       std::set<std::shared_ptr<detail::Type_Conversion_Base>> m_conversions;
-      std::set<const std::type_info *, Less_Than> m_convertableTypes;
+      /// indexed by Type_Info::bare_id()
+      std::vector<bool> m_convertableTypes;
+      /// m_conversions by (to, from) type
+      Conversion_Map m_index;
+      /// the conversions that can be chained, by the type they convert from
+      std::unordered_multimap<uint32_t, std::shared_ptr<detail::Type_Conversion_Base>> m_chainable;
+      /// conversions that are not in m_index, found by find_chain(). Null if there is no chain
+      mutable Conversion_Map m_chains;
       std::atomic_size_t m_num_types;
-      mutable chaiscript::detail::threading::Thread_Storage<std::set<const std::type_info *, Less_Than>> m_thread_cache;
+      std::atomic_size_t m_num_conversions;
+      mutable chaiscript::detail::threading::Thread_Storage<Convertable_Types> m_thread_cache;
+      mutable chaiscript::detail::threading::Thread_Storage<Resolved_Cache> m_resolved_cache;
       mutable chaiscript::detail::threading::Thread_Storage<Conversion_Saves> m_conversion_saves;
+      chaiscript::detail::Dispatch_Engine *m_engine = nullptr;
   };
 
   class Type_Conversions_State
@@ -7,10 +7,16 @@
 #ifndef CHAISCRIPT_TYPE_INFO_HPP_
 #define CHAISCRIPT_TYPE_INFO_HPP_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <type_traits>
+#include <typeindex>
 #include <typeinfo>
 #include <string>
+#include <unordered_map>
+
+#include "../chaiscript_threading.hpp"
 
 namespace chaiscript
 {
@@ -22,6 +28,72 @@ namespace chaiscript
       {
         typedef typename std::remove_cv<typename std::remove_pointer<typename std::remove_reference<T>::type>::type>::type type;
       };
+
+    /// Assigns each type a dense integer id the first time it is seen, so that types can
+    /// be compared and hashed without comparing std::type_info objects. Comparing those
+    /// can mean comparing their names, a type has a type_info in each shared library it is used in.
+    class Type_Ids
+    {
+      public:
+        /// Never destroyed, types can still be compared during static destruction
+        static Type_Ids &instance()
+        {
+          static Type_Ids *ids = new Type_Ids();
+          return *ids;
+        }
+
+        /// \returns the id of t_ti, ids start at 1
+        uint32_t intern(const std::type_info &t_ti)
+        {
+          chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+          return m_ids.emplace(std::type_index(t_ti), static_cast<uint32_t>(m_ids.size() + 1)).first->second;
+        }
+
+        /// \returns the id cached in t_slot, interning t_ti on first use
+        static uint32_t id(std::atomic<uint32_t> &t_slot, const std::type_info &t_ti)
+        {
+          auto id = t_slot.load(std::memory_order_acquire);
+          if (id == 0) {
+            id = instance().intern(t_ti);
+            t_slot.store(id, std::memory_order_release);
+          }
+          return id;
+        }
+
+      private:
+        Type_Ids() = default;
+
+        chaiscript::detail::threading::shared_mutex m_mutex;
+        std::unordered_map<std::type_index, uint32_t> m_ids;
+    };
+
+    /// One per type and binary, its address identifies the type at compile time and
+    /// it caches the type's id from Type_Ids
+    template<typename T>
+      struct Type_Slot
+      {
+        static std::atomic<uint32_t> id;
+        /// Shared by all slots of a binary, slots are only comparable if their tags match
+        static const char tag;
+      };
+
+    template<typename T>
+      std::atomic<uint32_t> Type_Slot<T>::id{0};
+
+    template<typename T>
+      const char Type_Slot<T>::tag = 0;
+
+    /// typeid ignores references and top level cv-qualifiers, so does the slot
+    template<typename T>
+      constexpr std::atomic<uint32_t> *type_slot()
+      {
+        return &Type_Slot<typename std::remove_cv<typename std::remove_reference<T>::type>::type>::id;
+      }
+
+    constexpr const char *type_slot_tag()
+    {
+      return &Type_Slot<void>::tag;
+    }
   }
 
 
@@ -30,8 +102,9 @@ namespace chaiscript
   {
     public:
       constexpr Type_Info(const bool t_is_const, const bool t_is_reference, const bool t_is_pointer, const bool t_is_void, 
-          const bool t_is_arithmetic, const std::type_info *t_ti, const std::type_info *t_bare_ti)
-        : m_type_info(t_ti), m_bare_type_info(t_bare_ti),
+          const bool t_is_arithmetic, const std::type_info *t_ti, const std::type_info *t_bare_ti,
+          const char *t_slot_tag = nullptr, std::atomic<uint32_t> *t_slot = nullptr, std::atomic<uint32_t> *t_bare_slot = nullptr)
+        : m_type_info(t_ti), m_bare_type_info(t_bare_ti), m_slot_tag(t_slot_tag), m_slot(t_slot), m_bare_slot(t_bare_slot),
           m_flags((static_cast<unsigned int>(t_is_const) << is_const_flag)
                 + (static_cast<unsigned int>(t_is_reference) << is_reference_flag)
                 + (static_cast<unsigned int>(t_is_pointer) << is_pointer_flag)
@@ -59,8 +132,9 @@ namespace chaiscript
 
       constexpr bool operator==(const Type_Info &ti) const noexcept
       {
-        return ti.m_type_info == m_type_info
-           || *ti.m_type_info == *m_type_info;
+        return (m_slot_tag != nullptr && ti.m_slot_tag == m_slot_tag)
+           ? ti.m_slot == m_slot
+           : (ti.m_type_info == m_type_info || *ti.m_type_info == *m_type_info);
       }
 
       constexpr bool operator==(const std::type_info &ti) const noexcept
@@ -70,8 +144,9 @@ namespace chaiscript
 
       constexpr bool bare_equal(const Type_Info &ti) const noexcept
       {
-        return ti.m_bare_type_info == m_bare_type_info
-           || *ti.m_bare_type_info == *m_bare_type_info;
+        return (m_slot_tag != nullptr && ti.m_slot_tag == m_slot_tag)
+           ? ti.m_bare_slot == m_bare_slot
+           : (ti.m_bare_type_info == m_bare_type_info || *ti.m_bare_type_info == *m_bare_type_info);
       }
 
       constexpr bool bare_equal_type_info(const std::type_info &ti) const noexcept
@@ -111,11 +186,29 @@ namespace chaiscript
         return m_bare_type_info;
       }
 
+      /// \returns a dense id of the bare type, 0 if this is undefined. Types that are
+      /// bare_equal have the same id
+      uint32_t bare_id() const
+      {
+        if (m_slot_tag != nullptr && m_slot_tag == detail::type_slot_tag()) {
+          return detail::Type_Ids::id(*m_bare_slot, *m_bare_type_info);
+        } else if (is_undef()) {
+          return 0;
+        } else {
+          // created in a shared library that has its own copy of the ids
+          return detail::Type_Ids::instance().intern(*m_bare_type_info);
+        }
+      }
+
     private:
       struct Unknown_Type {};
 
       const std::type_info *m_type_info = &typeid(Unknown_Type);
       const std::type_info *m_bare_type_info = &typeid(Unknown_Type);
+      /// slots are only compared if they come from the same binary, null if built by hand
+      const char *m_slot_tag = nullptr;
+      std::atomic<uint32_t> *m_slot = nullptr;
+      std::atomic<uint32_t> *m_bare_slot = nullptr;
       static const int is_const_flag = 0;
       static const int is_reference_flag = 1;
       static const int is_pointer_flag = 2;
@@ -139,7 +232,8 @@ namespace chaiscript
               (std::is_arithmetic<T>::value || std::is_arithmetic<typename std::remove_reference<T>::type>::value)
                 && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
               &typeid(T),
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(typename Bare_Type<T>::type),
+              type_slot_tag(), type_slot<T>(), type_slot<typename Bare_Type<T>::type>());
         }
       };
 
@@ -153,8 +247,9 @@ namespace chaiscript
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(std::shared_ptr<T> ), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(std::shared_ptr<T> ),
+              &typeid(typename Bare_Type<T>::type),
+              type_slot_tag(), type_slot<std::shared_ptr<T> >(), type_slot<typename Bare_Type<T>::type>());
         }
       };
 
@@ -171,8 +266,9 @@ namespace chaiscript
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(const std::shared_ptr<T> &), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(const std::shared_ptr<T> &),
+              &typeid(typename Bare_Type<T>::type),
+              type_slot_tag(), type_slot<const std::shared_ptr<T> &>(), type_slot<typename Bare_Type<T>::type>());
         }
       };
 
@@ -184,8 +280,9 @@ namespace chaiscript
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(std::reference_wrapper<T> ), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(std::reference_wrapper<T> ),
+              &typeid(typename Bare_Type<T>::type),
+              type_slot_tag(), type_slot<std::reference_wrapper<T> >(), type_slot<typename Bare_Type<T>::type>());
         }
       };
 
@@ -197,8 +294,9 @@ namespace chaiscript
           return Type_Info(std::is_const<T>::value, std::is_reference<T>::value, std::is_pointer<T>::value, 
               std::is_void<T>::value,
               std::is_arithmetic<T>::value && !std::is_same<typename std::remove_const<typename std::remove_reference<T>::type>::type, bool>::value,
-              &typeid(const std::reference_wrapper<T> &), 
-              &typeid(typename Bare_Type<T>::type));
+              &typeid(const std::reference_wrapper<T> &),
+              &typeid(typename Bare_Type<T>::type),
+              type_slot_tag(), type_slot<const std::reference_wrapper<T> &>(), type_slot<typename Bare_Type<T>::type>());
         }
       };
 
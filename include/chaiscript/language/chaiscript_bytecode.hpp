@@ -0,0 +1,522 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_BYTECODE_HPP_
+#define CHAISCRIPT_BYTECODE_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+#include "../dispatchkit/boxed_number.hpp"
+#include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/dispatchkit.hpp"
+#include "chaiscript_algebraic.hpp"
+#include "chaiscript_common.hpp"
+#include "chaiscript_eval.hpp"
+
+namespace chaiscript
+{
+  namespace eval
+  {
+    /// \brief Flat, register based form of a pure expression tree.
+    ///
+    /// Trees made up of only Constant, Id, Prefix and Binary nodes are lowered
+    /// into a linear sequence of instructions that is executed by a single loop.
+    /// Registers hold int and double intermediates natively, so only the final
+    /// result of an arithmetic expression is boxed. Anything the fast path does
+    /// not know about goes through exactly the same Boxed_Number / call_function
+    /// path the tree walker uses. Trees containing other node types are left to
+    /// the tree walker.
+    template<typename T>
+    class Bytecode_Program
+    {
+      public:
+        static const size_t max_registers = 16;
+
+        /// Attempts to lower t_node. Returns nullptr if the tree contains a node that cannot be
+        /// expressed or if the tree has fewer than t_min_operations operators.
+        static std::shared_ptr<const Bytecode_Program> compile(const AST_Node_Impl_Ptr<T> &t_node, const size_t t_min_operations = 2)
+        {
+          auto program = std::make_shared<Bytecode_Program>();
+          if (!program->lower(t_node, 0)) {
+            return nullptr;
+          }
+
+          if (program->m_num_operations < t_min_operations) {
+            return nullptr;
+          }
+
+          program->m_locs = std::vector<std::atomic_uint_fast32_t>(program->m_code.size());
+          program->m_caches.reset(new dispatch::Dispatch_Cache[program->m_code.size()]);
+          return program;
+        }
+
+        Boxed_Value run(const chaiscript::detail::Dispatch_State &t_ss) const
+        {
+          Register_File regs;
+          const Instruction *current = nullptr;
+
+          try {
+            for (const auto &inst : m_code) {
+              current = &inst;
+              if (&inst != &m_code.back()) {
+                // the root node is traced by the owning Compiled_AST_Node
+                T::trace(t_ss, inst.node);
+              }
+
+              switch (inst.op) {
+                case Op_Code::load_constant:
+                  regs.set(inst.dest, Boxed_Value(m_constants[inst.operand]));
+                  break;
+                case Op_Code::load_id:
+                  regs.set(inst.dest, load_id(t_ss, inst));
+                  break;
+                case Op_Code::prefix:
+                  prefix(t_ss, inst, regs);
+                  break;
+                case Op_Code::binary:
+                  binary(t_ss, inst, regs);
+                  break;
+              }
+            }
+          } catch (exception::eval_error &ee) {
+            if (current && current != &m_code.back()) {
+              ee.call_stack.push_back(current->node->shared_from_this());
+            }
+            throw;
+          }
+
+          return std::move(regs.box(0));
+        }
+
+        size_t num_registers() const noexcept { return m_num_registers; }
+        size_t size() const noexcept { return m_code.size(); }
+
+        Bytecode_Program() = default;
+        Bytecode_Program(const Bytecode_Program &) = delete;
+        Bytecode_Program &operator=(const Bytecode_Program &) = delete;
+
+      private:
+        enum class Op_Code : uint8_t
+        {
+          load_constant,
+          load_id,
+          prefix,
+          binary
+        };
+
+        struct Instruction
+        {
+          Op_Code op;
+          Operators::Opers oper;
+          uint8_t dest;
+          uint8_t lhs;
+          uint8_t rhs;
+          uint32_t operand;
+          uint32_t loc;
+          const AST_Node_Impl<T> *node;
+        };
+
+        enum class Value_Kind : uint8_t
+        {
+          boxed,
+          int_value,
+          double_value
+        };
+
+        /// Fixed size set of registers living on the C++ stack. A register either holds
+        /// a Boxed_Value or a native int / double, which is only boxed when a consumer
+        /// needs the Boxed_Value.
+        class Register_File
+        {
+          public:
+            Register_File() = default;
+            Register_File(const Register_File &) = delete;
+            Register_File &operator=(const Register_File &) = delete;
+
+            ~Register_File()
+            {
+              for (auto &reg : m_regs) {
+                reg.reset();
+              }
+            }
+
+            void set(const size_t t_reg, Boxed_Value &&t_bv)
+            {
+              auto &reg = m_regs[t_reg];
+              reg.reset();
+
+              // the value itself is read through the box when it is used, it
+              // might be a variable that is modified later in the expression
+              const auto &ti = t_bv.get_type_info();
+              if (ti.is_arithmetic() && ti == typeid(int)) {
+                reg.kind = Value_Kind::int_value;
+              } else if (ti.is_arithmetic() && ti == typeid(double)) {
+                reg.kind = Value_Kind::double_value;
+              } else {
+                reg.kind = Value_Kind::boxed;
+              }
+
+              new (&reg.storage) Boxed_Value(std::move(t_bv));
+              reg.has_box = true;
+            }
+
+            void set(const size_t t_reg, const int t_value)
+            {
+              auto &reg = m_regs[t_reg];
+              reg.reset();
+              reg.kind = Value_Kind::int_value;
+              reg.int_value = t_value;
+            }
+
+            void set(const size_t t_reg, const double t_value)
+            {
+              auto &reg = m_regs[t_reg];
+              reg.reset();
+              reg.kind = Value_Kind::double_value;
+              reg.double_value = t_value;
+            }
+
+            void set(const size_t t_reg, const bool t_value)
+            {
+              set(t_reg, const_var(t_value));
+            }
+
+            Value_Kind kind(const size_t t_reg) const { return m_regs[t_reg].kind; }
+
+            int get_int(const size_t t_reg) const
+            {
+              const auto &reg = m_regs[t_reg];
+              return reg.has_box ? *static_cast<const int *>(reg.get_box().get_const_ptr()) : reg.int_value;
+            }
+
+            double get_double(const size_t t_reg) const
+            {
+              const auto &reg = m_regs[t_reg];
+              return reg.has_box ? *static_cast<const double *>(reg.get_box().get_const_ptr()) : reg.double_value;
+            }
+
+            /// Returns the register as a Boxed_Value, boxing a native value the
+            /// same way Boxed_Number results are boxed
+            Boxed_Value &box(const size_t t_reg)
+            {
+              auto &reg = m_regs[t_reg];
+              if (!reg.has_box) {
+                if (reg.kind == Value_Kind::int_value) {
+                  new (&reg.storage) Boxed_Value(const_var(reg.int_value));
+                } else {
+                  new (&reg.storage) Boxed_Value(const_var(reg.double_value));
+                }
+                reg.has_box = true;
+              }
+              return reg.get_box();
+            }
+
+          private:
+            struct Register
+            {
+              Boxed_Value &get_box()
+              {
+                return *reinterpret_cast<Boxed_Value *>(&storage);
+              }
+
+              const Boxed_Value &get_box() const
+              {
+                return *reinterpret_cast<const Boxed_Value *>(&storage);
+              }
+
+              void reset()
+              {
+                if (has_box) {
+                  get_box().~Boxed_Value();
+                  has_box = false;
+                }
+              }
+
+              Value_Kind kind = Value_Kind::boxed;
+              bool has_box = false;
+              union {
+                int int_value;
+                double double_value;
+              };
+              typename std::aligned_storage<sizeof(Boxed_Value), alignof(Boxed_Value)>::type storage;
+            };
+
+            Register m_regs[max_registers];
+        };
+
+        static const AST_Node_Impl_Ptr<T> &original(const AST_Node_Impl_Ptr<T> &t_node)
+        {
+          if (t_node->identifier == AST_Node_Type::Compiled) {
+            return dynamic_cast<const Compiled_AST_Node<T> &>(*t_node).m_original_node;
+          } else {
+            return t_node;
+          }
+        }
+
+        bool emit(Op_Code t_op, const AST_Node_Impl_Ptr<T> &t_node, const size_t t_dest, const uint32_t t_operand = 0,
+            const Operators::Opers t_oper = Operators::Opers::invalid)
+        {
+          m_code.push_back(Instruction{t_op, t_oper, static_cast<uint8_t>(t_dest), static_cast<uint8_t>(t_dest), static_cast<uint8_t>(t_dest + 1),
+              t_operand, static_cast<uint32_t>(m_code.size()), t_node.get()});
+          m_nodes.push_back(t_node);
+          return true;
+        }
+
+        /// Emits code leaving the value of t_node in register t_dest, subexpressions
+        /// only ever use registers above t_dest
+        bool lower(const AST_Node_Impl_Ptr<T> &t_node, const size_t t_dest)
+        {
+          if (t_dest >= max_registers) {
+            return false;
+          }
+
+          m_num_registers = std::max(m_num_registers, t_dest + 1);
+
+          const auto &node = original(t_node);
+
+          switch (node->identifier) {
+            case AST_Node_Type::Constant:
+              if (const auto constant = dynamic_cast<const Constant_AST_Node<T> *>(node.get())) {
+                m_constants.push_back(constant->m_value);
+              } else {
+                return false;
+              }
+              return emit(Op_Code::load_constant, node, t_dest, static_cast<uint32_t>(m_constants.size() - 1));
+
+            case AST_Node_Type::Id:
+              if (dynamic_cast<const Id_AST_Node<T> *>(node.get()) == nullptr) {
+                return false;
+              }
+              return emit(Op_Code::load_id, node, t_dest);
+
+            case AST_Node_Type::Prefix:
+              if (node->children.size() != 1 || !lower(node->children[0], t_dest)) {
+                return false;
+              }
+              ++m_num_operations;
+              return emit(Op_Code::prefix, node, t_dest, 0, Operators::to_operator(node->text, true));
+
+            case AST_Node_Type::Binary:
+              if (node->children.size() != 2 || !lower(node->children[0], t_dest) || !lower(node->children[1], t_dest + 1)) {
+                return false;
+              }
+              ++m_num_operations;
+              return emit(Op_Code::binary, node, t_dest, 0, Operators::to_operator(node->text));
+
+            default:
+              return false;
+          }
+        }
+
+        template<typename N>
+          static void check_divide_by_zero(const N t_value, typename std::enable_if<std::is_integral<N>::value>::type* = nullptr)
+          {
+#ifndef CHAISCRIPT_NO_PROTECT_DIVIDEBYZERO
+            if (t_value == 0) {
+              throw chaiscript::exception::arithmetic_error("divide by zero");
+            }
+#endif
+          }
+
+        template<typename N>
+          static void check_divide_by_zero(const N, typename std::enable_if<std::is_floating_point<N>::value>::type* = nullptr)
+          {
+          }
+
+        static bool integer_arithmetic(const Operators::Opers t_oper, const int t_lhs, const int t_rhs, Register_File &t_regs, const size_t t_dest)
+        {
+          switch (t_oper) {
+            case Operators::Opers::shift_left:
+              t_regs.set(t_dest, t_lhs << t_rhs);
+              return true;
+            case Operators::Opers::shift_right:
+              t_regs.set(t_dest, t_lhs >> t_rhs);
+              return true;
+            case Operators::Opers::remainder:
+              check_divide_by_zero(t_rhs);
+              t_regs.set(t_dest, t_lhs % t_rhs);
+              return true;
+            case Operators::Opers::bitwise_and:
+              t_regs.set(t_dest, t_lhs & t_rhs);
+              return true;
+            case Operators::Opers::bitwise_or:
+              t_regs.set(t_dest, t_lhs | t_rhs);
+              return true;
+            case Operators::Opers::bitwise_xor:
+              t_regs.set(t_dest, t_lhs ^ t_rhs);
+              return true;
+            default:
+              return false;
+          }
+        }
+
+        static bool integer_arithmetic(const Operators::Opers, const double, const double, Register_File &, const size_t)
+        {
+          return false;
+        }
+
+        /// Native equivalent of Boxed_Number::do_oper for operands that share the common type N.
+        /// Returns false for anything that needs the generic path.
+        template<typename N>
+          static bool arithmetic(const Operators::Opers t_oper, const N t_lhs, const N t_rhs, Register_File &t_regs, const size_t t_dest)
+          {
+            switch (t_oper) {
+              case Operators::Opers::equals:
+                t_regs.set(t_dest, t_lhs == t_rhs);
+                return true;
+              case Operators::Opers::less_than:
+                t_regs.set(t_dest, t_lhs < t_rhs);
+                return true;
+              case Operators::Opers::greater_than:
+                t_regs.set(t_dest, t_lhs > t_rhs);
+                return true;
+              case Operators::Opers::less_than_equal:
+                t_regs.set(t_dest, t_lhs <= t_rhs);
+                return true;
+              case Operators::Opers::greater_than_equal:
+                t_regs.set(t_dest, t_lhs >= t_rhs);
+                return true;
+              case Operators::Opers::not_equal:
+                t_regs.set(t_dest, t_lhs != t_rhs);
+                return true;
+              case Operators::Opers::sum:
+                t_regs.set(t_dest, t_lhs + t_rhs);
+                return true;
+              case Operators::Opers::quotient:
+                check_divide_by_zero(t_rhs);
+                t_regs.set(t_dest, t_lhs / t_rhs);
+                return true;
+              case Operators::Opers::product:
+                t_regs.set(t_dest, t_lhs * t_rhs);
+                return true;
+              case Operators::Opers::difference:
+                t_regs.set(t_dest, t_lhs - t_rhs);
+                return true;
+              default:
+                return integer_arithmetic(t_oper, t_lhs, t_rhs, t_regs, t_dest);
+            }
+          }
+
+        static double as_double(const Register_File &t_regs, const size_t t_reg)
+        {
+          return t_regs.kind(t_reg) == Value_Kind::int_value ? static_cast<double>(t_regs.get_int(t_reg)) : t_regs.get_double(t_reg);
+        }
+
+        Boxed_Value load_id(const chaiscript::detail::Dispatch_State &t_ss, const Instruction &t_inst) const
+        {
+          // the node does its own lookup so that frame slots resolved after
+          // this program was compiled are still used
+          return static_cast<const Id_AST_Node<T> *>(t_inst.node)->lookup(t_ss);
+        }
+
+        void prefix(const chaiscript::detail::Dispatch_State &t_ss, const Instruction &t_inst, Register_File &t_regs) const
+        {
+          const auto kind = t_regs.kind(t_inst.lhs);
+
+          if (kind == Value_Kind::int_value) {
+            const auto value = t_regs.get_int(t_inst.lhs);
+            switch (t_inst.oper) {
+              case Operators::Opers::unary_minus:
+                return t_regs.set(t_inst.dest, -value);
+              case Operators::Opers::unary_plus:
+                return t_regs.set(t_inst.dest, +value);
+              case Operators::Opers::bitwise_complement:
+                return t_regs.set(t_inst.dest, ~value);
+              default:
+                break;
+            }
+          } else if (kind == Value_Kind::double_value) {
+            const auto value = t_regs.get_double(t_inst.lhs);
+            switch (t_inst.oper) {
+              case Operators::Opers::unary_minus:
+                return t_regs.set(t_inst.dest, -value);
+              case Operators::Opers::unary_plus:
+                return t_regs.set(t_inst.dest, +value);
+              default:
+                break;
+            }
+          }
+
+          auto &bv = t_regs.box(t_inst.lhs);
+
+          try {
+            // short circuit arithmetic operations
+            if (t_inst.oper != Operators::Opers::invalid && t_inst.oper != Operators::Opers::bitwise_and && bv.get_type_info().is_arithmetic())
+            {
+              t_regs.set(t_inst.dest, Boxed_Number::do_oper(t_inst.oper, bv));
+            } else {
+              chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
+              fpp.save_params(Function_Params{bv});
+              t_regs.set(t_inst.dest, t_ss->call_function(t_inst.node->text, m_locs[t_inst.loc], Function_Params{bv}, t_ss.conversions(), &m_caches[t_inst.loc]));
+            }
+          } catch (const exception::dispatch_error &e) {
+            throw exception::eval_error("Error with prefix operator evaluation: '" + t_inst.node->text + "'", e.parameters, e.functions, false, *t_ss);
+          }
+        }
+
+        void binary(const chaiscript::detail::Dispatch_State &t_ss, const Instruction &t_inst, Register_File &t_regs) const
+        {
+          const auto lhs_kind = t_regs.kind(t_inst.lhs);
+          const auto rhs_kind = t_regs.kind(t_inst.rhs);
+
+          if (lhs_kind == Value_Kind::int_value && rhs_kind == Value_Kind::int_value) {
+            if (arithmetic(t_inst.oper, t_regs.get_int(t_inst.lhs), t_regs.get_int(t_inst.rhs), t_regs, t_inst.dest)) {
+              return;
+            }
+          } else if (lhs_kind != Value_Kind::boxed && rhs_kind != Value_Kind::boxed) {
+            if (arithmetic(t_inst.oper, as_double(t_regs, t_inst.lhs), as_double(t_regs, t_inst.rhs), t_regs, t_inst.dest)) {
+              return;
+            }
+          }
+
+          const auto &oper_string = t_inst.node->text;
+          const auto &lhs = t_regs.box(t_inst.lhs);
+          const auto &rhs = t_regs.box(t_inst.rhs);
+
+          try {
+            if (t_inst.oper != Operators::Opers::invalid && lhs.get_type_info().is_arithmetic() && rhs.get_type_info().is_arithmetic())
+            {
+              // If it's an arithmetic operation we want to short circuit dispatch
+              try{
+                t_regs.set(t_inst.dest, Boxed_Number::do_oper(t_inst.oper, lhs, rhs));
+              } catch (const chaiscript::exception::arithmetic_error &) {
+                throw;
+              } catch (...) {
+                throw exception::eval_error("Error with numeric operator calling: " + oper_string);
+              }
+            } else {
+              chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
+              const std::array<Boxed_Value, 2> params{{lhs, rhs}};
+              fpp.save_params(params);
+              t_regs.set(t_inst.dest, t_ss->call_function(oper_string, m_locs[t_inst.loc], params, t_ss.conversions(), &m_caches[t_inst.loc]));
+            }
+          }
+          catch(const exception::dispatch_error &e){
+            throw exception::eval_error("Can not find appropriate '" + oper_string + "' operator.", e.parameters, e.functions, false, *t_ss);
+          }
+        }
+
+        std::vector<Instruction> m_code;
+        std::vector<Boxed_Value> m_constants;
+        std::vector<AST_Node_Impl_Ptr<T>> m_nodes;
+        mutable std::vector<std::atomic_uint_fast32_t> m_locs;
+        mutable std::unique_ptr<dispatch::Dispatch_Cache[]> m_caches;
+        size_t m_num_registers = 0;
+        size_t m_num_operations = 0;
+    };
+  }
+}
+
+#endif /* CHAISCRIPT_BYTECODE_HPP_ */
@@ -569,8 +569,24 @@ namespace chaiscript
     {
       public:
         virtual AST_NodePtr parse(const std::string &t_input, const std::string &t_fname) = 0;
+        /// Parses the characters in [t_begin, t_end), the default copies them into a string
+        virtual AST_NodePtr parse(const char *t_begin, const char *t_end, const std::string &t_fname)
+        {
+          return parse(std::string(t_begin, t_end), t_fname);
+        }
         virtual void debug_print(AST_NodePtr t, std::string prepend = "") const = 0;
         virtual void *get_tracer_ptr() = 0;
+        /// Appends a binary form of t_ast, which load() turns back into the same tree, to t_data
+        /// \returns false if the tree has no binary form, which is the default
+        virtual bool save(const AST_NodePtr &/*t_ast*/, std::string &/*t_data*/) const
+        {
+          return false;
+        }
+        /// \returns the tree t_data was saved from, or null if it was saved by another kind of parser
+        virtual AST_NodePtr load(const std::string &/*t_data*/)
+        {
+          return AST_NodePtr();
+        }
         virtual ~ChaiScript_Parser_Base() = default;
         ChaiScript_Parser_Base() = default;
         ChaiScript_Parser_Base(ChaiScript_Parser_Base &&) = default;
@@ -613,6 +629,69 @@ namespace chaiscript
       };
 
 
+      /// Marks a return, break or continue as pending instead of throwing it. Nodes that
+      /// evaluate statements stop as soon as control flow is pending and the enclosing
+      /// loop or function call completes it.
+      inline void set_control_flow(const chaiscript::detail::Dispatch_State &t_ds, const chaiscript::detail::Control_Flow t_flow)
+      {
+        t_ds.stack_holder().control_flow = t_flow;
+      }
+
+      inline void set_return_value(const chaiscript::detail::Dispatch_State &t_ds, Boxed_Value t_retval)
+      {
+        auto &holder = t_ds.stack_holder();
+        holder.return_value = std::move(t_retval);
+        holder.control_flow = chaiscript::detail::Control_Flow::return_value;
+      }
+
+      inline bool control_flow_pending(const chaiscript::detail::Dispatch_State &t_ds)
+      {
+        return t_ds.stack_holder().control_flow != chaiscript::detail::Control_Flow::none;
+      }
+
+      /// Completes a pending break or continue at the end of a loop iteration. Returns
+      /// true if the loop has to stop, a pending return is left for the enclosing function.
+      inline bool end_loop_iteration(const chaiscript::detail::Dispatch_State &t_ds)
+      {
+        auto &flow = t_ds.stack_holder().control_flow;
+        switch (flow) {
+          case chaiscript::detail::Control_Flow::none:
+            return false;
+          case chaiscript::detail::Control_Flow::continue_loop:
+            flow = chaiscript::detail::Control_Flow::none;
+            return false;
+          case chaiscript::detail::Control_Flow::break_loop:
+            flow = chaiscript::detail::Control_Flow::none;
+            return true;
+          case chaiscript::detail::Control_Flow::return_value:
+            return true;
+        }
+        return true;
+      }
+
+      /// Completes any pending control flow where a function call or an eval ends.
+      /// A pending return yields its value, a break or continue is thrown on to a
+      /// loop of the caller.
+      inline Boxed_Value end_function(const chaiscript::detail::Dispatch_State &t_ds, Boxed_Value t_retval)
+      {
+        auto &holder = t_ds.stack_holder();
+        const auto flow = holder.control_flow;
+        holder.control_flow = chaiscript::detail::Control_Flow::none;
+
+        switch (flow) {
+          case chaiscript::detail::Control_Flow::none:
+            return t_retval;
+          case chaiscript::detail::Control_Flow::return_value:
+            return std::move(holder.return_value);
+          case chaiscript::detail::Control_Flow::break_loop:
+            throw Break_Loop();
+          case chaiscript::detail::Control_Flow::continue_loop:
+            throw Continue_Loop();
+        }
+        return t_retval;
+      }
+
+
       /// Creates a new scope then pops it on destruction
       struct Scope_Push_Pop
       {
@@ -656,7 +735,7 @@ namespace chaiscript
           m_ds->pop_function_call(m_ds.stack_holder(), m_ds.conversion_saves());
         }
 
-        void save_params(const std::vector<Boxed_Value> &t_params)
+        void save_params(const Function_Params &t_params)
         {
           m_ds->save_function_params(t_params);
         }
@@ -671,6 +750,34 @@ namespace chaiscript
           const chaiscript::detail::Dispatch_State &m_ds;
       };
 
+      /// Bounds the params that function calls save in a loop's scope. Without it they would only
+      /// be released when the loop's scope is popped or the outermost call returns
+      struct Loop_Params
+      {
+        Loop_Params(const Loop_Params &) = delete;
+        Loop_Params& operator=(const Loop_Params &) = delete;
+
+        /// Must be created in the loop's own scope
+        explicit Loop_Params(const chaiscript::detail::Dispatch_State &t_ds)
+          : m_ds(t_ds),
+            m_mark(m_ds->mark_function_params(m_ds.stack_holder(), m_ds.conversion_saves())),
+            m_references(m_ds.stack_holder().references_bound)
+        {
+        }
+
+        /// Called as an iteration starts, releases what the previous iterations saved unless
+        /// a reference that can point into it was bound meanwhile
+        void release() const
+        {
+          m_ds->release_function_params(m_ds.stack_holder(), m_ds.conversion_saves(), m_mark, m_references);
+        }
+
+        private:
+          const chaiscript::detail::Dispatch_State &m_ds;
+          mutable size_t m_mark;
+          mutable size_t m_references;
+      };
+
       /// Creates a new scope then pops it on destruction
       struct Stack_Push_Pop
       {
@@ -679,10 +786,11 @@ namespace chaiscript
         Stack_Push_Pop(const Stack_Push_Pop &) = delete;
         Stack_Push_Pop& operator=(const Stack_Push_Pop &) = delete;
 
-        explicit Stack_Push_Pop(const chaiscript::detail::Dispatch_State &t_ds)
+        /// \param[in] t_owner node the frame is laid out for, see chaiscript::detail::Frame_Slot
+        explicit Stack_Push_Pop(const chaiscript::detail::Dispatch_State &t_ds, const void *t_owner = nullptr)
           : m_ds(t_ds)
         {
-          m_ds->new_stack(m_ds.stack_holder());
+          m_ds->new_stack(m_ds.stack_holder(), t_owner);
         }
 
         ~Stack_Push_Pop()
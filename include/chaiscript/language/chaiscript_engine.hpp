@@ -14,9 +14,12 @@
 #include <map>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 #include <vector>
+#include <cstdio>
 #include <cstring>
 
 #include "../chaiscript_defines.hpp"
@@ -26,6 +29,7 @@
 #include "../dispatchkit/dispatchkit.hpp"
 #include "../dispatchkit/type_conversions.hpp"
 #include "../dispatchkit/proxy_functions.hpp"
+#include "../utility/fnv1a.hpp"
 #include "chaiscript_common.hpp"
 
 #if defined(__linux__) || defined(__unix__) || defined(__APPLE__) || defined(__HAIKU__)
@@ -56,6 +60,53 @@ namespace chaiscript
     typedef std::shared_ptr<Loadable_Module> Loadable_Module_Ptr;
   }
 
+  /// \brief A library made ready for engines to start from
+  ///
+  /// Applying a Module registers each of its functions and parses its ChaiScript again for
+  /// every engine. An image does this once, keeping the registry the module's types,
+  /// functions and global constants make, which engines share until they add to it, and
+  /// the module's ChaiScript already parsed. Functions defined in ChaiScript belong to the
+  /// engine that evaluates them, so each engine still evaluates the parsed definitions.
+  ///
+  /// \sa ChaiScript::standard_library
+  class Library_Image
+  {
+    public:
+      Library_Image(const ModulePtr &t_lib, parser::ChaiScript_Parser_Base &t_parser)
+        : m_conversions(t_lib->get_conversions())
+      {
+        chaiscript::detail::Dispatch_Engine engine(t_parser);
+        t_lib->apply_native(engine);
+        m_state = engine.get_state();
+
+        for (const auto &eval : t_lib->get_evals()) {
+          m_evals.push_back(t_parser.parse(eval, "__EVAL__"));
+        }
+      }
+
+      /// Applies the image to an engine nothing has been added to yet
+      template<typename Eval>
+        void apply(Eval &t_eval, chaiscript::detail::Dispatch_Engine &t_engine) const
+        {
+          t_engine.set_state(m_state);
+
+          for (const auto &ast : m_evals) {
+            t_eval.eval(ast);
+          }
+
+          for (const auto &conversion : m_conversions) {
+            t_engine.add(conversion);
+          }
+        }
+
+    private:
+      chaiscript::detail::Dispatch_Engine::State m_state;
+      std::vector<AST_NodePtr> m_evals;
+      std::vector<Type_Conversion> m_conversions;
+  };
+
+  typedef std::shared_ptr<const Library_Image> Library_ImagePtr;
+
 
   /// \brief The main object that the ChaiScript user will use.
   class ChaiScript_Basic {
@@ -63,12 +114,23 @@ namespace chaiscript
     mutable chaiscript::detail::threading::shared_mutex m_mutex;
     mutable chaiscript::detail::threading::recursive_mutex m_use_mutex;
 
-    std::set<std::string> m_used_files;
+    /// never modified once set, so that State objects can share them
+    std::shared_ptr<const std::set<std::string>> m_used_files = std::make_shared<const std::set<std::string>>();
     std::map<std::string, detail::Loadable_Module_Ptr> m_loaded_modules;
-    std::set<std::string> m_active_loaded_modules;
+    std::shared_ptr<const std::set<std::string>> m_active_loaded_modules = std::make_shared<const std::set<std::string>>();
+
+    /// Replaces t_set with a copy that also holds t_name
+    static void insert_name(std::shared_ptr<const std::set<std::string>> &t_set, const std::string &t_name)
+    {
+      auto names = std::make_shared<std::set<std::string>>(*t_set);
+      names->insert(t_name);
+      t_set = std::move(names);
+    }
 
     std::vector<std::string> m_module_paths;
     std::vector<std::string> m_use_paths;
+    std::vector<Options> m_options;
+    std::string m_ast_cache_directory;
 
     std::unique_ptr<parser::ChaiScript_Parser_Base> m_parser;
 
@@ -76,16 +138,78 @@ namespace chaiscript
 
     /// Evaluates the given string in by parsing it and running the results through the evaluator
     Boxed_Value do_eval(const std::string &t_input, const std::string &t_filename = "__EVAL__", bool /* t_internal*/  = false) 
+    {
+      return do_eval(m_parser->parse(t_input, t_filename));
+    }
+
+    /// Runs an already parsed script through the evaluator
+    Boxed_Value do_eval(const AST_NodePtr &t_ast)
     {
       try {
-        const auto p = m_parser->parse(t_input, t_filename);
-        return p->eval(chaiscript::detail::Dispatch_State(m_engine));
+        const chaiscript::detail::Dispatch_State state(m_engine);
+        return chaiscript::eval::detail::end_function(state, t_ast->eval(state));
       }
       catch (chaiscript::eval::detail::Return_Value &rv) {
         return rv.retval;
       }
     }
 
+    /// Parses the contents of a file, reusing the tree kept in the AST cache directory
+    /// when the file has not changed since it was kept
+    AST_NodePtr parse_file(const chaiscript::detail::Mapped_File &t_file, const std::string &t_filename)
+    {
+      const auto directory = [this]() {
+        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+        return m_ast_cache_directory;
+      }();
+
+      if (directory.empty()) {
+        return m_parser->parse(t_file.begin(), t_file.end(), t_filename);
+      }
+
+      // one tree is kept per file, an edited file's tree replaces the one kept before. The
+      // file name is in the stamp as well, it is in the tree's locations and in __FILE__, and
+      // the format the parser writes ahead of the tree holds the version.
+      const auto content_hash = utility::fnv1a_64(t_file.begin(), t_file.end());
+      const auto stamp = t_filename + '\0' + std::to_string(t_file.end() - t_file.begin()) + '\0' + std::to_string(content_hash) + '\0';
+
+      const auto source = chaiscript::detail::canonical_path(t_filename);
+      std::ostringstream path;
+      path << directory << std::hex << utility::fnv1a_64(source.data(), source.data() + source.size()) << ".chaiast";
+
+      try {
+        const auto data = load_file(path.str());
+        if (data.compare(0, stamp.size(), stamp) == 0) {
+          if (const auto ast = m_parser->load(data.substr(stamp.size()))) {
+            return ast;
+          }
+        }
+      } catch (const exception::file_not_found_error &) {
+        // not kept yet
+      }
+
+      const auto ast = m_parser->parse(t_file.begin(), t_file.end(), t_filename);
+
+      std::string data = stamp;
+      if (m_parser->save(ast, data)) {
+        // written aside and renamed, so that no one reads a partly written tree
+        try {
+          const auto temp = path.str() + '.' + std::to_string(std::random_device()());
+          {
+            std::ofstream outfile(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+            outfile.write(data.data(), static_cast<std::streamsize>(data.size()));
+          }
+          if (std::rename(temp.c_str(), path.str().c_str()) != 0) {
+            std::remove(temp.c_str());
+          }
+        } catch (const std::exception &) {
+          // the cache is only an optimization
+        }
+      }
+
+      return ast;
+    }
+
 
 
     /// Evaluates the given file and looks in the 'use' paths
@@ -94,7 +218,8 @@ namespace chaiscript
       {
         try {
           const auto appendedpath = path + t_filename;
-          return do_eval(load_file(appendedpath), appendedpath, true);
+          const chaiscript::detail::Mapped_File file(appendedpath);
+          return do_eval(parse_file(file, appendedpath));
         } catch (const exception::file_not_found_error &) {
           // failed to load, try the next path
         } catch (const exception::eval_error &t_ee) {
@@ -123,24 +248,21 @@ namespace chaiscript
       return m_engine;
     }
 
-    /// Builds all the requirements for ChaiScript, including its evaluator and a run of its prelude.
-    void build_eval_system(const ModulePtr &t_lib, const std::vector<Options> &t_opts) {
-      if (t_lib)
-      {
-        add(t_lib);
-      }
+    /// Builds all the requirements for ChaiScript, including its evaluator. The library has already been applied.
+    void build_eval_system(const std::vector<Options> &t_opts) {
+      m_options = t_opts;
 
-      m_engine.add(fun([this](){ m_engine.dump_system(); }), "dump_system");
-      m_engine.add(fun([this](const Boxed_Value &t_bv){ m_engine.dump_object(t_bv); }), "dump_object");
-      m_engine.add(fun([this](const Boxed_Value &t_bv, const std::string &t_type){ return m_engine.is_type(t_bv, t_type); }), "is_type");
-      m_engine.add(fun([this](const Boxed_Value &t_bv){ return m_engine.type_name(t_bv); }), "type_name");
-      m_engine.add(fun([this](const std::string &t_f){ return m_engine.function_exists(t_f); }), "function_exists");
-      m_engine.add(fun([this](){ return m_engine.get_function_objects(); }), "get_functions");
-      m_engine.add(fun([this](){ return m_engine.get_scripting_objects(); }), "get_objects");
+      m_engine.replace(fun([this](){ m_engine.dump_system(); }), "dump_system");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv){ m_engine.dump_object(t_bv); }), "dump_object");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv, const std::string &t_type){ return m_engine.is_type(t_bv, t_type); }), "is_type");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv){ return m_engine.type_name(t_bv); }), "type_name");
+      m_engine.replace(fun([this](const std::string &t_f){ return m_engine.function_exists(t_f); }), "function_exists");
+      m_engine.replace(fun([this](){ return m_engine.get_function_objects(); }), "get_functions");
+      m_engine.replace(fun([this](){ return m_engine.get_scripting_objects(); }), "get_objects");
 
-      m_engine.add(
+      m_engine.replace(
           dispatch::make_dynamic_proxy_function(
-              [this](const std::vector<Boxed_Value> &t_params) {
+              [this](const Function_Params &t_params) {
                 return m_engine.call_exists(t_params);
               })
           , "call_exists");
@@ -149,19 +271,19 @@ namespace chaiscript
 //
 //
 
-      m_engine.add(fun(
+      m_engine.replace(fun(
             [=](const dispatch::Proxy_Function_Base &t_fun, const std::vector<Boxed_Value> &t_params) -> Boxed_Value {
               Type_Conversions_State s(this->m_engine.conversions(), this->m_engine.conversions().conversion_saves());
               return t_fun(t_params, s);
             }), "call");
 
 
-      m_engine.add(fun([this](const Type_Info &t_ti){ return m_engine.get_type_name(t_ti); }), "name");
+      m_engine.replace(fun([this](const Type_Info &t_ti){ return m_engine.get_type_name(t_ti); }), "name");
 
-      m_engine.add(fun([this](const std::string &t_type_name, bool t_throw){ return m_engine.get_type(t_type_name, t_throw); }), "type");
-      m_engine.add(fun([this](const std::string &t_type_name){ return m_engine.get_type(t_type_name, true); }), "type");
+      m_engine.replace(fun([this](const std::string &t_type_name, bool t_throw){ return m_engine.get_type(t_type_name, t_throw); }), "type");
+      m_engine.replace(fun([this](const std::string &t_type_name){ return m_engine.get_type(t_type_name, true); }), "type");
 
-      m_engine.add(fun(
+      m_engine.replace(fun(
             [=](const Type_Info &t_from, const Type_Info &t_to, const std::function<Boxed_Value (const Boxed_Value &)> &t_func) {
               m_engine.add(chaiscript::type_conversion(t_from, t_to, t_func));
             }
@@ -172,27 +294,27 @@ namespace chaiscript
       if (std::find(t_opts.begin(), t_opts.end(), Options::No_Load_Modules) == t_opts.end()
           && std::find(t_opts.begin(), t_opts.end(), Options::Load_Modules) != t_opts.end()) 
       {
-        m_engine.add(fun([this](const std::string &t_module, const std::string &t_file){ return load_module(t_module, t_file); }), "load_module");
-        m_engine.add(fun([this](const std::string &t_module){ return load_module(t_module); }), "load_module");
+        m_engine.replace(fun([this](const std::string &t_module, const std::string &t_file){ return load_module(t_module, t_file); }), "load_module");
+        m_engine.replace(fun([this](const std::string &t_module){ return load_module(t_module); }), "load_module");
       }
 
       if (std::find(t_opts.begin(), t_opts.end(), Options::No_External_Scripts) == t_opts.end()
           && std::find(t_opts.begin(), t_opts.end(), Options::External_Scripts) != t_opts.end())
       {
-        m_engine.add(fun([this](const std::string &t_file){ return use(t_file); }), "use");
-        m_engine.add(fun([this](const std::string &t_file){ return internal_eval_file(t_file); }), "eval_file");
+        m_engine.replace(fun([this](const std::string &t_file){ return use(t_file); }), "use");
+        m_engine.replace(fun([this](const std::string &t_file){ return internal_eval_file(t_file); }), "eval_file");
       }
 
-      m_engine.add(fun([this](const std::string &t_str){ return internal_eval(t_str); }), "eval");
-      m_engine.add(fun([this](const AST_NodePtr &t_ast){ return eval(t_ast); }), "eval");
+      m_engine.replace(fun([this](const std::string &t_str){ return internal_eval(t_str); }), "eval");
+      m_engine.replace(fun([this](const AST_NodePtr &t_ast){ return eval(t_ast); }), "eval");
 
-      m_engine.add(fun([this](const std::string &t_str, const bool t_dump){ return parse(t_str, t_dump); }), "parse");
-      m_engine.add(fun([this](const std::string &t_str){ return parse(t_str); }), "parse");
+      m_engine.replace(fun([this](const std::string &t_str, const bool t_dump){ return parse(t_str, t_dump); }), "parse");
+      m_engine.replace(fun([this](const std::string &t_str){ return parse(t_str); }), "parse");
 
 
-      m_engine.add(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ add_global_const(t_bv, t_name); }), "add_global_const");
-      m_engine.add(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ add_global(t_bv, t_name); }), "add_global");
-      m_engine.add(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ set_global(t_bv, t_name); }), "set_global");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ add_global_const(t_bv, t_name); }), "add_global_const");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ add_global(t_bv, t_name); }), "add_global");
+      m_engine.replace(fun([this](const Boxed_Value &t_bv, const std::string &t_name){ set_global(t_bv, t_name); }), "set_global");
     }
 
 
@@ -209,14 +331,11 @@ namespace chaiscript
 
       assert(size >= 0);
 
-      if (size == std::streampos(0))
-      {
-        return std::string();
-      } else {
-        std::vector<char> v(static_cast<size_t>(size));
-        infile.read(&v[0], size);
-        return std::string(v.begin(), v.end());
+      std::string contents(static_cast<size_t>(size), '\0');
+      if (!contents.empty()) {
+        infile.read(&contents[0], size);
       }
+      return contents;
     }
 
     std::vector<std::string> ensure_minimum_path_vec(std::vector<std::string> paths)
@@ -225,26 +344,10 @@ namespace chaiscript
       else { return paths; }
     }
 
-  public:
-
-    /// \brief Constructor for ChaiScript
-    /// \param[in] t_lib Standard library to apply to this ChaiScript instance
-    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
-    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
-    ChaiScript_Basic(const ModulePtr &t_lib,
-                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
-                     std::vector<std::string> t_module_paths = {},
-                     std::vector<std::string> t_use_paths = {},
-                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
-      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
-        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
-        m_parser(std::move(parser)),
-        m_engine(*m_parser)
+    /// If on Unix, adds the path of the current executable to the module search path as windows would do
+    void add_executable_path()
     {
 #if defined(_POSIX_VERSION) && !defined(__CYGWIN__) 
-      // If on Unix, add the path of the current executable to the module search path
-      // as windows would do
-
       union cast_union
       {
         Boxed_Value (ChaiScript_Basic::*in_ptr)(const std::string&);
@@ -274,7 +377,83 @@ namespace chaiscript
         m_module_paths.insert(m_module_paths.begin(), dllpath+"/");
       }
 #endif
-      build_eval_system(t_lib, t_opts);
+    }
+
+  public:
+
+    /// \brief Constructor for ChaiScript
+    /// \param[in] t_lib Standard library to apply to this ChaiScript instance
+    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
+    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
+    ChaiScript_Basic(const ModulePtr &t_lib,
+                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
+                     std::vector<std::string> t_module_paths = {},
+                     std::vector<std::string> t_use_paths = {},
+                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
+        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
+        m_parser(std::move(parser)),
+        m_engine(*m_parser)
+    {
+      add_executable_path();
+
+      if (t_lib)
+      {
+        add(t_lib);
+      }
+
+      build_eval_system(t_opts);
+    }
+
+    /// \brief Constructor for ChaiScript, starting from a library image
+    /// \param[in] t_image Library image to attach this ChaiScript instance to
+    /// \param[in] t_modulepaths Vector of paths to search when attempting to load a binary module
+    /// \param[in] t_usepaths Vector of paths to search when attempting to "use" an included ChaiScript file
+    ChaiScript_Basic(const Library_ImagePtr &t_image,
+                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser,
+                     std::vector<std::string> t_module_paths = {},
+                     std::vector<std::string> t_use_paths = {},
+                     const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
+      : m_module_paths(ensure_minimum_path_vec(std::move(t_module_paths))),
+        m_use_paths(ensure_minimum_path_vec(std::move(t_use_paths))),
+        m_parser(std::move(parser)),
+        m_engine(*m_parser)
+    {
+      add_executable_path();
+
+      if (t_image)
+      {
+        t_image->apply(*this, m_engine);
+      }
+
+      build_eval_system(t_opts);
+    }
+
+    /// \brief Constructor for a fork of a ChaiScript instance
+    ///
+    /// The fork starts out with the functions, types, globals, conversions, used files and
+    /// options of t_parent, sharing them until either changes them, and goes its own way from
+    /// there. Functions t_parent defined in ChaiScript are evaluated in the fork when the fork
+    /// calls them. Functions added from C++ are shared as they are.
+    /// \param[in] t_parent ChaiScript instance to fork
+    ChaiScript_Basic(const ChaiScript_Basic &t_parent,
+                     std::unique_ptr<parser::ChaiScript_Parser_Base> &&parser)
+      : m_parser(std::move(parser)),
+        m_engine(t_parent.m_engine, *m_parser)
+    {
+      {
+        chaiscript::detail::threading::lock_guard<chaiscript::detail::threading::recursive_mutex> l(t_parent.m_use_mutex);
+        chaiscript::detail::threading::shared_lock<chaiscript::detail::threading::shared_mutex> l2(t_parent.m_mutex);
+
+        m_used_files = t_parent.m_used_files;
+        m_loaded_modules = t_parent.m_loaded_modules;
+        m_active_loaded_modules = t_parent.m_active_loaded_modules;
+        m_module_paths = t_parent.m_module_paths;
+        m_use_paths = t_parent.m_use_paths;
+        m_ast_cache_directory = t_parent.m_ast_cache_directory;
+      }
+
+      build_eval_system(t_parent.m_options);
     }
 
     /// \brief Constructor for ChaiScript.
@@ -288,7 +467,7 @@ namespace chaiscript
                      std::vector<std::string> t_module_paths = {},
                      std::vector<std::string> t_use_paths = {},
                      const std::vector<chaiscript::Options> &t_opts = chaiscript::default_options())
-      : ChaiScript_Basic({}, std::move(parser), t_module_paths, t_use_paths, t_opts)
+      : ChaiScript_Basic(ModulePtr(), std::move(parser), t_module_paths, t_use_paths, t_opts)
     {
       try {
         // attempt to load the stdlib
@@ -307,6 +486,26 @@ namespace chaiscript
       }
     }
 
+    /// \brief Keeps the parsed form of the files given to eval_file and use in t_directory
+    ///
+    /// A file is parsed the first time it is seen, and the optimized tree is written to
+    /// t_directory, under a name made from the file's canonical path. When the same file is
+    /// evaluated again, by this or any other ChaiScript instance using the directory, the
+    /// tree is read back instead of parsing the file. A file that was changed since, or a
+    /// tree written by another version of ChaiScript or another parser, is parsed again and
+    /// its tree replaced.
+    /// \param[in] t_directory Existing directory to keep the trees in, an empty string turns
+    ///                        the cache off, which is the default
+    void set_ast_cache_directory(std::string t_directory)
+    {
+      if (!t_directory.empty() && t_directory.back() != '/' && t_directory.back() != '\\') {
+        t_directory += '/';
+      }
+
+      chaiscript::detail::threading::unique_lock<chaiscript::detail::threading::shared_mutex> l(m_mutex);
+      m_ast_cache_directory = std::move(t_directory);
+    }
+
     parser::ChaiScript_Parser_Base &get_parser()
     {
       return *m_parser;
@@ -315,7 +514,8 @@ namespace chaiscript
     const Boxed_Value eval(const AST_NodePtr &t_ast)
     {
       try {
-        return t_ast->eval(chaiscript::detail::Dispatch_State(m_engine));
+        const chaiscript::detail::Dispatch_State state(m_engine);
+        return chaiscript::eval::detail::end_function(state, t_ast->eval(state));
       } catch (const exception::eval_error &t_ee) {
         throw Boxed_Value(t_ee);
       }
@@ -360,12 +560,12 @@ namespace chaiscript
 
           Boxed_Value retval;
 
-          if (m_used_files.count(appendedpath) == 0)
+          if (m_used_files->count(appendedpath) == 0)
           {
             l2.unlock();
             retval = eval_file(appendedpath);
             l2.lock();
-            m_used_files.insert(appendedpath);
+            insert_name(m_used_files, appendedpath);
           }
 
           return retval; // return, we loaded it, or it was already loaded
@@ -416,9 +616,9 @@ namespace chaiscript
     /// \sa ChaiScript::set_state
     struct State
     {
-      std::set<std::string> used_files;
+      std::shared_ptr<const std::set<std::string>> used_files;
       chaiscript::detail::Dispatch_Engine::State engine_state;
-      std::set<std::string> active_loaded_modules;
+      std::shared_ptr<const std::set<std::string>> active_loaded_modules;
     };
 
     /// \brief Returns a state object that represents the current state of the global system
@@ -597,10 +797,10 @@ namespace chaiscript
       {
         detail::Loadable_Module_Ptr lm(new detail::Loadable_Module(t_module_name, t_filename));
         m_loaded_modules[t_module_name] = lm;
-        m_active_loaded_modules.insert(t_module_name);
+        insert_name(m_active_loaded_modules, t_module_name);
         add(lm->m_moduleptr);
-      } else if (m_active_loaded_modules.count(t_module_name) == 0) {
-        m_active_loaded_modules.insert(t_module_name);
+      } else if (m_active_loaded_modules->count(t_module_name) == 0) {
+        insert_name(m_active_loaded_modules, t_module_name);
         add(m_loaded_modules[t_module_name]->m_moduleptr);
       } 
     }
@@ -674,7 +874,15 @@ namespace chaiscript
     /// \return result of the script execution
     /// \throw chaiscript::exception::eval_error In the case that evaluation fails.
     Boxed_Value eval_file(const std::string &t_filename, const Exception_Handler &t_handler = Exception_Handler()) {
-      return eval(load_file(t_filename), t_handler, t_filename);
+      const chaiscript::detail::Mapped_File file(t_filename);
+      try {
+        return do_eval(parse_file(file, t_filename));
+      } catch (Boxed_Value &bv) {
+        if (t_handler) {
+          t_handler->handle(bv, m_engine);
+        }
+        throw;
+      }
     }
 
     /// \brief Loads the file specified by filename, evaluates it, and returns the type safe result.
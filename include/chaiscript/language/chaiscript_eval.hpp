@@ -7,8 +7,14 @@
 #ifndef CHAISCRIPT_EVAL_HPP_
 #define CHAISCRIPT_EVAL_HPP_
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
 #include <exception>
 #include <functional>
+#include <iterator>
 #include <limits>
 #include <map>
 #include <memory>
@@ -49,7 +55,8 @@ namespace chaiscript
     {
       /// Helper function that will set up the scope around a function call, including handling the named function parameters
       template<typename T>
-      static Boxed_Value eval_function(chaiscript::detail::Dispatch_Engine &t_ss, const AST_Node_Impl_Ptr<T> &t_node, const std::vector<std::string> &t_param_names, const std::vector<Boxed_Value> &t_vals, const std::map<std::string, Boxed_Value> *t_locals=nullptr) {
+      static Boxed_Value eval_function(chaiscript::detail::Dispatch_Engine &t_ss, const AST_Node_Impl_Ptr<T> &t_node, const std::vector<std::string> &t_param_names, const Function_Params &t_vals, const std::map<std::string, Boxed_Value> *t_locals=nullptr,
+          const chaiscript::detail::Frame_Layout &t_layout = chaiscript::detail::Frame_Layout()) {
         chaiscript::detail::Dispatch_State state(t_ss);
 
         const Boxed_Value *thisobj = [&]() -> const Boxed_Value *{
@@ -63,27 +70,135 @@ namespace chaiscript
           }
         }();
 
-        chaiscript::eval::detail::Stack_Push_Pop tpp(state);
-        if (thisobj) { state.add_object("this", *thisobj); }
+        chaiscript::eval::detail::Stack_Push_Pop tpp(state, t_node.get());
+        if (t_layout.params != 0) {
+          auto &slots = state.stack_holder().frame_slots;
+          assert(thisobj);
+          slots.push_back(*thisobj);
 
-        if (t_locals) {
-          for (const auto &local : *t_locals) {
-            state.add_object(local.first, local.second);
+          if (t_locals) {
+            for (const auto &local : *t_locals) {
+              slots.push_back(local.second);
+            }
           }
-        }
 
-        for (size_t i = 0; i < t_param_names.size(); ++i) {
-          if (t_param_names[i] != "this") {
-            state.add_object(t_param_names[i], t_vals[i]);
+          for (size_t i = 0; i < t_param_names.size(); ++i) {
+            if (t_param_names[i] != "this") {
+              slots.push_back(t_vals[i]);
+            }
+          }
+          assert(slots.size() - state.stack_holder().frame_bases.back() == t_layout.params);
+        } else {
+          if (thisobj) { state.add_object("this", *thisobj); }
+
+          if (t_locals) {
+            for (const auto &local : *t_locals) {
+              state.add_object(local.first, local.second);
+            }
+          }
+
+          for (size_t i = 0; i < t_param_names.size(); ++i) {
+            if (t_param_names[i] != "this") {
+              state.add_object(t_param_names[i], t_vals[i]);
+            }
           }
         }
 
         try {
-          return t_node->eval(state);
+          return detail::end_function(state, t_node->eval(state));
         } catch (detail::Return_Value &rv) {
           return std::move(rv.retval);
         } 
       }
+
+      /// The names eval_function stores in the slots of a frame with a Frame_Layout, in order
+      inline std::vector<std::string> frame_slot_names(const std::vector<std::string> &t_param_names, std::vector<std::string> t_captures = {}) {
+        std::vector<std::string> names{"this"};
+        std::sort(t_captures.begin(), t_captures.end());
+        names.insert(names.end(), t_captures.begin(), std::unique(t_captures.begin(), t_captures.end()));
+        std::copy_if(t_param_names.begin(), t_param_names.end(), std::back_inserter(names),
+            [](const std::string &t_name) { return t_name != "this"; });
+        return names;
+      }
+
+      /// The engine a script function is defined in. Forks of the engine share the function,
+      /// so it is evaluated in the engine calling it when that engine is of the same family,
+      /// which keeps the function's lookups within the fork that made the call. Other calls are
+      /// evaluated in the defining engine, or in another engine of its family once it is gone.
+      class Defining_Engine
+      {
+        public:
+          explicit Defining_Engine(chaiscript::detail::Dispatch_Engine &t_engine)
+            : m_engine(&t_engine), m_family(t_engine.family())
+          {
+          }
+
+          /// \returns the engine to evaluate a call made with t_conversions in
+          chaiscript::detail::Dispatch_Engine &get(const Type_Conversions_State &t_conversions) const
+          {
+            auto *caller = t_conversions->get_engine();
+            if (caller != nullptr && caller->family() == m_family) {
+              return *caller;
+            } else if (auto *engine = m_family->find(m_engine)) {
+              return *engine;
+            } else {
+              throw chaiscript::exception::eval_error("Function called after every engine it was defined in was destroyed");
+            }
+          }
+
+        private:
+          chaiscript::detail::Dispatch_Engine *m_engine;
+          std::shared_ptr<chaiscript::detail::Engine_Family> m_family;
+      };
+
+      /// Arithmetic for an operator node that specializes itself on the operand types it sees.
+      /// After the first evaluation with two int or two double operands the node goes straight
+      /// to the native operation for that type. Any other combination of types deoptimizes it
+      /// for good, after which it behaves exactly like Boxed_Number::do_oper.
+      class Quickened_Oper
+      {
+        public:
+          Boxed_Value do_oper(const Operators::Opers t_oper, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs) const
+          {
+            switch (m_state.load(std::memory_order_relaxed)) {
+              case State::int_int:
+                if (both_are<int>(t_lhs, t_rhs)) {
+                  return Boxed_Number::do_oper_as<int>(t_oper, t_lhs, t_rhs);
+                }
+                break;
+              case State::double_double:
+                if (both_are<double>(t_lhs, t_rhs)) {
+                  return Boxed_Number::do_oper_as<double>(t_oper, t_lhs, t_rhs);
+                }
+                break;
+              case State::unspecialized:
+                if (both_are<int>(t_lhs, t_rhs)) {
+                  m_state.store(State::int_int, std::memory_order_relaxed);
+                  return Boxed_Number::do_oper_as<int>(t_oper, t_lhs, t_rhs);
+                } else if (both_are<double>(t_lhs, t_rhs)) {
+                  m_state.store(State::double_double, std::memory_order_relaxed);
+                  return Boxed_Number::do_oper_as<double>(t_oper, t_lhs, t_rhs);
+                }
+                break;
+              case State::generic:
+                return Boxed_Number::do_oper(t_oper, t_lhs, t_rhs);
+            }
+
+            m_state.store(State::generic, std::memory_order_relaxed);
+            return Boxed_Number::do_oper(t_oper, t_lhs, t_rhs);
+          }
+
+        private:
+          enum class State : uint8_t { unspecialized, int_int, double_double, generic };
+
+          template<typename N>
+          static bool both_are(const Boxed_Value &t_lhs, const Boxed_Value &t_rhs)
+          {
+            return t_lhs.get_type_info().bare_equal_type_info(typeid(N)) && t_rhs.get_type_info().bare_equal_type_info(typeid(N));
+          }
+
+          mutable std::atomic<State> m_state{State::unspecialized};
+      };
     }
 
     template<typename T>
@@ -166,7 +281,7 @@ namespace chaiscript
             {
               // If it's an arithmetic operation we want to short circuit dispatch
               try{
-                return Boxed_Number::do_oper(m_oper, t_lhs, m_rhs);
+                return m_quickened.do_oper(m_oper, t_lhs, m_rhs);
               } catch (const chaiscript::exception::arithmetic_error &) {
                 throw;
               } catch (...) {
@@ -174,8 +289,9 @@ namespace chaiscript
               }
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({t_lhs, m_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, m_rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{t_lhs, m_rhs}};
+              fpp.save_params(params);
+              return t_ss->call_function(t_oper_string, m_loc, params, t_ss.conversions(), &m_cache);
             }
           }
           catch(const exception::dispatch_error &e){
@@ -187,6 +303,8 @@ namespace chaiscript
         Operators::Opers m_oper;
         Boxed_Value m_rhs;
         mutable std::atomic_uint_fast32_t m_loc = {0};
+        mutable dispatch::Dispatch_Cache m_cache;
+        detail::Quickened_Oper m_quickened;
     };
 
 
@@ -203,7 +321,7 @@ namespace chaiscript
           return do_oper(t_ss, m_oper, this->text, lhs, rhs);
         }
 
-      protected:
+        /// Applies the operator to operands that have already been evaluated
         Boxed_Value do_oper(const chaiscript::detail::Dispatch_State &t_ss, 
             Operators::Opers t_oper, const std::string &t_oper_string, const Boxed_Value &t_lhs, const Boxed_Value &t_rhs) const
         {
@@ -212,7 +330,7 @@ namespace chaiscript
             {
               // If it's an arithmetic operation we want to short circuit dispatch
               try{
-                return Boxed_Number::do_oper(t_oper, t_lhs, t_rhs);
+                return m_quickened.do_oper(t_oper, t_lhs, t_rhs);
               } catch (const chaiscript::exception::arithmetic_error &) {
                 throw;
               } catch (...) {
@@ -220,8 +338,9 @@ namespace chaiscript
               }
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({t_lhs, t_rhs});
-              return t_ss->call_function(t_oper_string, m_loc, {t_lhs, t_rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{t_lhs, t_rhs}};
+              fpp.save_params(params);
+              return t_ss->call_function(t_oper_string, m_loc, params, t_ss.conversions(), &m_cache);
             }
           }
           catch(const exception::dispatch_error &e){
@@ -232,6 +351,8 @@ namespace chaiscript
       private:
         Operators::Opers m_oper;
         mutable std::atomic_uint_fast32_t m_loc = {0};
+        mutable dispatch::Dispatch_Cache m_cache;
+        detail::Quickened_Oper m_quickened;
     };
 
 
@@ -263,16 +384,34 @@ namespace chaiscript
         { }
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
+          return lookup(t_ss);
+        }
+
+        Boxed_Value lookup(const chaiscript::detail::Dispatch_State &t_ss) const {
+          if (m_slot.owner != nullptr) {
+            if (const auto obj = t_ss.get_frame_object(m_slot)) {
+              return *obj;
+            }
+          }
+
           try {
-            return t_ss.get_object(this->text, m_loc);
+            return t_ss.get_object(this->text, m_loc, m_hash);
           }
           catch (std::exception &) {
             throw exception::eval_error("Can not find object: " + this->text);
           }
         }
 
+        /// Binds this identifier to a fixed slot of the frame pushed for t_slot.owner
+        void set_frame_slot(const chaiscript::detail::Frame_Slot &t_slot) {
+          m_slot = t_slot;
+        }
+
       private:
         mutable std::atomic_uint_fast32_t m_loc = {0};
+        /// hash of the name, for lookups in the function registry that miss m_loc
+        const size_t m_hash = chaiscript::detail::hash_name(this->text);
+        chaiscript::detail::Frame_Slot m_slot;
     };
 
     template<typename T>
@@ -285,7 +424,7 @@ namespace chaiscript
         {
           chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
 
-          std::vector<Boxed_Value> params;
+          Param_List params;
 
           params.reserve(this->children[1]->children.size());
           for (const auto &child : this->children[1]->children) {
@@ -299,7 +438,7 @@ namespace chaiscript
           Boxed_Value fn(this->children[0]->eval(t_ss));
 
           try {
-            return (*t_ss->boxed_cast<const dispatch::Proxy_Function_Base *>(fn))(params, t_ss.conversions());
+            return t_ss->boxed_cast<const dispatch::Proxy_Function_Base *>(fn)->call(params, t_ss.conversions(), m_cache);
           }
           catch(const exception::dispatch_error &e){
             throw exception::eval_error(std::string(e.what()) + " with function '" + this->children[0]->text + "'", e.parameters, e.functions, false, *t_ss);
@@ -308,7 +447,7 @@ namespace chaiscript
             try {
               Const_Proxy_Function f = t_ss->boxed_cast<const Const_Proxy_Function &>(fn);
               // handle the case where there is only 1 function to try to call and dispatch fails on it
-              throw exception::eval_error("Error calling function '" + this->children[0]->text + "'", params, {f}, false, *t_ss);
+              throw exception::eval_error("Error calling function '" + this->children[0]->text + "'", std::vector<Boxed_Value>(params.begin(), params.end()), {f}, false, *t_ss);
             } catch (const exception::bad_boxed_cast &) {
               throw exception::eval_error("'" + this->children[0]->pretty_print() + "' does not evaluate to a function.");
             }
@@ -329,6 +468,8 @@ namespace chaiscript
           return do_eval_internal<true>(t_ss);
         }
 
+      private:
+        mutable dispatch::Dispatch_Cache m_cache;
     };
 
 
@@ -421,7 +562,7 @@ namespace chaiscript
               rhs.get_type_info().is_arithmetic())
           {
             try {
-              return Boxed_Number::do_oper(m_oper, lhs, rhs);
+              return m_quickened.do_oper(m_oper, lhs, rhs);
             } catch (const std::exception &) {
               throw exception::eval_error("Error with unsupported arithmetic assignment operation");
             }
@@ -443,20 +584,23 @@ namespace chaiscript
                 {
                   /// \todo This does not handle the case of an unassigned reference variable
                   ///       being assigned outside of its declaration
+                  note_reference(t_ss, rhs);
                   lhs.assign(rhs);
                   lhs.reset_return_value();
                   return rhs;
                 } else {
                   if (!rhs.is_return_value())
                   {
-                    rhs = t_ss->call_function("clone", m_clone_loc, {rhs}, t_ss.conversions());
+                    rhs = t_ss->call_function("clone", m_clone_loc, Function_Params{rhs}, t_ss.conversions());
                   }
+                  note_reference(t_ss, rhs);
                   rhs.reset_return_value();
                 }
               }
 
               try {
-                return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+                const std::array<Boxed_Value, 2> params{{std::move(lhs), rhs}};
+                return t_ss->call_function(this->text, m_loc, params, t_ss.conversions());
               }
               catch(const exception::dispatch_error &e){
                 throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
@@ -468,6 +612,7 @@ namespace chaiscript
           }
           else if (this->text == ":=") {
             if (lhs.is_undef() || Boxed_Value::type_match(lhs, rhs)) {
+              note_reference(t_ss, rhs);
               lhs.assign(rhs);
               lhs.reset_return_value();
             } else {
@@ -476,7 +621,8 @@ namespace chaiscript
           }
           else {
             try {
-              return t_ss->call_function(this->text, m_loc, {std::move(lhs), rhs}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> params{{std::move(lhs), rhs}};
+              return t_ss->call_function(this->text, m_loc, params, t_ss.conversions());
             } catch(const exception::dispatch_error &e){
               throw exception::eval_error("Unable to find appropriate'" + this->text + "' operator.", e.parameters, e.functions, false, *t_ss);
             }
@@ -486,9 +632,18 @@ namespace chaiscript
         }
 
       private:
+        /// Binding a reference to a name can keep it past the params saved for the values it points into
+        static void note_reference(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_rhs)
+        {
+          if (t_rhs.is_ref()) {
+            ++t_ss.stack_holder().references_bound;
+          }
+        }
+
         Operators::Opers m_oper;
         mutable std::atomic_uint_fast32_t m_loc = {0};
         mutable std::atomic_uint_fast32_t m_clone_loc = {0};
+        detail::Quickened_Oper m_quickened;
     };
 
     template<typename T>
@@ -522,12 +677,22 @@ namespace chaiscript
 
           try {
             Boxed_Value bv;
-            t_ss.add_object(idname, bv);
+            if (m_slot.owner == nullptr || !t_ss.add_frame_object(bv, m_slot)) {
+              t_ss.add_object(idname, bv);
+            }
             return bv;
           } catch (const exception::name_conflict_error &e) {
             throw exception::eval_error("Variable redefined '" + e.name() + "'");
           }
         }
+
+        /// Declares the variable directly at a fixed slot of the frame pushed for t_slot.owner
+        void set_frame_slot(const chaiscript::detail::Frame_Slot &t_slot) {
+          m_slot = t_slot;
+        }
+
+      private:
+        chaiscript::detail::Frame_Slot m_slot;
     };
 
 
@@ -539,7 +704,7 @@ namespace chaiscript
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
           chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
 
-          const std::vector<Boxed_Value> params{this->children[0]->eval(t_ss), this->children[1]->eval(t_ss)};
+          const std::array<Boxed_Value, 2> params{{this->children[0]->eval(t_ss), this->children[1]->eval(t_ss)}};
 
           try {
             fpp.save_params(params);
@@ -568,11 +733,13 @@ namespace chaiscript
 
 
           Boxed_Value retval = this->children[0]->eval(t_ss);
-          std::vector<Boxed_Value> params{retval};
+          Param_List params;
+          params.push_back(retval);
 
           bool has_function_params = false;
           if (this->children[1]->children.size() > 1) {
             has_function_params = true;
+            params.reserve(this->children[1]->children[1]->children.size() + 1);
             for (const auto &child : this->children[1]->children[1]->children) {
               params.push_back(child->eval(t_ss));
             }
@@ -580,24 +747,45 @@ namespace chaiscript
 
           fpp.save_params(params);
 
-          try {
-            retval = t_ss->call_member(m_fun_name, m_loc, std::move(params), has_function_params, t_ss.conversions());
-          }
-          catch(const exception::dispatch_error &e){
-            if (e.functions.empty())
-            {
-              throw exception::eval_error("'" + m_fun_name + "' is not a function.");
-            } else {
-              throw exception::eval_error(std::string(e.what()) + " for function '" + m_fun_name + "'", e.parameters, e.functions, true, *t_ss);
+          // an attribute of a script object is read from the slot its shape has for it
+          const bool is_attribute_read = !has_function_params
+            && retval.get_type_info().bare_equal(user_type<dispatch::Dynamic_Object>()) && !retval.is_const();
+          std::shared_ptr<std::vector<Proxy_Function>> funcs;
+          const Boxed_Value *attr = nullptr;
+          if (is_attribute_read) {
+            uint_fast32_t loc = m_loc;
+            auto found = t_ss->get_function(m_fun_name, loc);
+            if (found.first != loc) { m_loc = uint_fast32_t(found.first); }
+            funcs = std::move(found.second);
+            attr = m_attr_cache.find(funcs.get(), *static_cast<dispatch::Dynamic_Object *>(retval.get_ptr()));
+          }
+
+          if (attr) {
+            retval = *attr;
+          } else {
+            try {
+              retval = t_ss->call_member(m_fun_name, m_loc, params, has_function_params, t_ss.conversions(), &m_cache);
+              if (is_attribute_read && !funcs->empty()) {
+                m_attr_cache.add(funcs, m_fun_name, *static_cast<const dispatch::Dynamic_Object *>(params[0].get_const_ptr()));
+              }
+            }
+            catch(const exception::dispatch_error &e){
+              if (e.functions.empty())
+              {
+                throw exception::eval_error("'" + m_fun_name + "' is not a function.");
+              } else {
+                throw exception::eval_error(std::string(e.what()) + " for function '" + m_fun_name + "'", e.parameters, e.functions, true, *t_ss);
+              }
+            }
+            catch(detail::Return_Value &rv) {
+              retval = std::move(rv.retval);
             }
-          }
-          catch(detail::Return_Value &rv) {
-            retval = std::move(rv.retval);
           }
 
           if (this->children[1]->identifier == AST_Node_Type::Array_Call) {
             try {
-              retval = t_ss->call_function("[]", m_array_loc, {retval, this->children[1]->children[1]->eval(t_ss)}, t_ss.conversions());
+              const std::array<Boxed_Value, 2> array_params{{retval, this->children[1]->children[1]->eval(t_ss)}};
+              retval = t_ss->call_function("[]", m_array_loc, array_params, t_ss.conversions());
             }
             catch(const exception::dispatch_error &e){
               throw exception::eval_error("Can not find appropriate array lookup operator '[]'.", e.parameters, e.functions, true, *t_ss);
@@ -610,6 +798,8 @@ namespace chaiscript
       private:
         mutable std::atomic_uint_fast32_t m_loc = {0};
         mutable std::atomic_uint_fast32_t m_array_loc = {0};
+        mutable dispatch::Dispatch_Cache m_cache;
+        mutable dispatch::detail::Attribute_Cache m_attr_cache;
         const std::string m_fun_name;
     };
 
@@ -634,22 +824,36 @@ namespace chaiscript
           const auto param_types = Arg_List_AST_Node<T>::get_arg_types(this->children[1], t_ss);
 
           const auto &lambda_node = this->children.back();
-          std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine(*t_ss);
+          const detail::Defining_Engine engine(*t_ss);
 
           return Boxed_Value(
               dispatch::make_dynamic_proxy_function(
-                  [engine, lambda_node, param_names = this->m_param_names, captures](const std::vector<Boxed_Value> &t_params)
+                  [engine, lambda_node, param_names = this->m_param_names, captures, layout = this->m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions)
                   {
-                    return detail::eval_function(engine, lambda_node, param_names, t_params, &captures);
+                    return detail::eval_function(engine.get(t_conversions), lambda_node, param_names, t_params, &captures, layout);
                   },
                   static_cast<int>(numparams), lambda_node, param_types
                 )
               );
         }
 
+        /// Stores `this`, the captures and the parameters in the frame's slots, see chaiscript::detail::Frame_Layout.
+        /// t_names are the names the slots were resolved for.
+        void set_frame_layout(const chaiscript::detail::Frame_Layout &t_layout, const std::vector<std::string> &t_names) {
+#ifndef NDEBUG
+          std::vector<std::string> captures;
+          for (const auto &capture : this->children[0]->children) {
+            captures.push_back(capture->children[0]->text);
+          }
+          assert(t_names.size() == t_layout.params && t_names == detail::frame_slot_names(m_param_names, captures));
+#endif
+          (void)t_names;
+          m_layout = t_layout;
+        }
+
       private:
         const std::vector<std::string> m_param_names;
-
+        chaiscript::detail::Frame_Layout m_layout;
     };
 
     template<typename T>
@@ -661,6 +865,9 @@ namespace chaiscript
           const auto num_children = this->children.size();
           for (size_t i = 0; i < num_children-1; ++i) {
             this->children[i]->eval(t_ss);
+            if (detail::control_flow_pending(t_ss)) {
+              return void_var();
+            }
           }
           return this->children.back()->eval(t_ss);
         }
@@ -677,6 +884,9 @@ namespace chaiscript
           const auto num_children = this->children.size();
           for (size_t i = 0; i < num_children-1; ++i) {
             this->children[i]->eval(t_ss);
+            if (detail::control_flow_pending(t_ss)) {
+              return void_var();
+            }
           }
           return this->children.back()->eval(t_ss);
         }
@@ -712,13 +922,13 @@ namespace chaiscript
             }
           }
 
-          std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine(*t_ss);
+          const detail::Defining_Engine engine(*t_ss);
           std::shared_ptr<dispatch::Proxy_Function_Base> guard;
           if (guardnode) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, guardnode, t_param_names](const std::vector<Boxed_Value> &t_params)
+                [engine, guardnode, t_param_names, layout = m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions)
                 {
-                  return detail::eval_function(engine, guardnode, t_param_names, t_params);
+                  return detail::eval_function(engine.get(t_conversions), guardnode, t_param_names, t_params, nullptr, layout);
                 },
                 static_cast<int>(numparams), guardnode);
           }
@@ -728,9 +938,9 @@ namespace chaiscript
             const auto & func_node = this->children.back();
             t_ss->add(
                 dispatch::make_dynamic_proxy_function(
-                  [engine, guardnode, func_node, t_param_names](const std::vector<Boxed_Value> &t_params)
+                  [engine, guardnode, func_node, t_param_names, layout = m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions)
                   {
-                    return detail::eval_function(engine, func_node, t_param_names, t_params);
+                    return detail::eval_function(engine.get(t_conversions), func_node, t_param_names, t_params, nullptr, layout);
                   },
                   static_cast<int>(numparams), this->children.back(),
                   param_types, guard), l_function_name);
@@ -740,6 +950,17 @@ namespace chaiscript
           return void_var();
         }
 
+        /// Stores `this` and the parameters in the frame's slots, see chaiscript::detail::Frame_Layout.
+        /// t_names are the names the slots were resolved for.
+        void set_frame_layout(const chaiscript::detail::Frame_Layout &t_layout, const std::vector<std::string> &t_names) {
+          assert(t_names.size() == t_layout.params && (this->children.size() > 2) && (this->children[1]->identifier == AST_Node_Type::Arg_List)
+              && t_names == detail::frame_slot_names(Arg_List_AST_Node<T>::get_arg_names(this->children[1])));
+          (void)t_names;
+          m_layout = t_layout;
+        }
+
+      private:
+        chaiscript::detail::Frame_Layout m_layout;
     };
 
     template<typename T>
@@ -749,11 +970,16 @@ namespace chaiscript
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override {
           chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+          const chaiscript::eval::detail::Loop_Params params(t_ss);
 
           try {
             while (this->get_scoped_bool_condition(*this->children[0], t_ss)) {
+              params.release();
               try {
                 this->children[1]->eval(t_ss);
+                if (detail::end_loop_iteration(t_ss)) {
+                  break;
+                }
               } catch (detail::Continue_Loop &) {
                 // we got a continue exception, which means all of the remaining 
                 // loop implementation is skipped and we just need to continue to
@@ -819,7 +1045,7 @@ namespace chaiscript
           };
 
           const auto call_function = [&t_ss](const auto &t_funcs, const Boxed_Value &t_param) {
-            return dispatch::dispatch(*t_funcs, {t_param}, t_ss.conversions());
+            return dispatch::dispatch(*t_funcs, Function_Params{t_param}, t_ss.conversions());
           };
 
 
@@ -831,10 +1057,15 @@ namespace chaiscript
             try {
               chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
               Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
+              const chaiscript::eval::detail::Loop_Params params(t_ss);
               for (auto loop_var : ranged_thing) {
                 obj = Boxed_Value(std::move(loop_var));
+                params.release();
                 try {
                   this->children[2]->eval(t_ss);
+                  if (detail::end_loop_iteration(t_ss)) {
+                    break;
+                  }
                 } catch (detail::Continue_Loop &) {
                 }
               }
@@ -848,29 +1079,69 @@ namespace chaiscript
             return do_loop(boxed_cast<const std::vector<Boxed_Value> &>(range_expression_result));
           } else if (range_expression_result.get_type_info().bare_equal_type_info(typeid(std::map<std::string, Boxed_Value>))) {
             return do_loop(boxed_cast<const std::map<std::string, Boxed_Value> &>(range_expression_result));
-          } else {
-            const auto range_funcs = get_function("range", m_range_loc);
-            const auto empty_funcs = get_function("empty", m_empty_loc);
-            const auto front_funcs = get_function("front", m_front_loc);
-            const auto pop_front_funcs = get_function("pop_front", m_pop_front_loc);
+          }
 
-            try {
-              const auto range_obj = call_function(range_funcs, range_expression_result);
-              chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
-              Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
-              while (!boxed_cast<bool>(call_function(empty_funcs, range_obj))) {
-                obj = call_function(front_funcs, range_obj);
-                try {
-                  this->children[2]->eval(t_ss);
-                } catch (detail::Continue_Loop &) {
+          // containers registered with input_range_type iterate natively. The function is
+          // called directly, errors thrown by the loop body are not a reason to try another one
+          const auto &iterations = t_ss->get_native_iterations();
+          if (!iterations.empty()) {
+            const std::array<Boxed_Value, 2> match_params{{range_expression_result, Boxed_Value(Iteration_Body())}};
+            const auto iteration = std::find_if(iterations.begin(), iterations.end(),
+                [&match_params, &t_ss](const Proxy_Function &t_func) { return t_func->call_match(match_params, t_ss.conversions()); });
+
+            if (iteration != iterations.end()) {
+              try {
+                chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+                Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
+                const chaiscript::eval::detail::Loop_Params loop_params(t_ss);
+
+                const Iteration_Body body = [&obj, &t_ss, &loop_params, this](const Boxed_Value &t_elem) {
+                  obj = t_elem;
+                  loop_params.release();
+                  try {
+                    this->children[2]->eval(t_ss);
+                    return detail::end_loop_iteration(t_ss);
+                  } catch (detail::Continue_Loop &) {
+                    return false;
+                  }
+                };
+
+                const std::array<Boxed_Value, 2> params{{range_expression_result, Boxed_Value(std::cref(body))}};
+                (**iteration)(params, t_ss.conversions());
+              } catch (detail::Break_Loop &) {
+                // loop broken
+              }
+              return void_var();
+            }
+          }
+
+          // anything else goes through range objects
+          const auto range_funcs = get_function("range", m_range_loc);
+          const auto empty_funcs = get_function("empty", m_empty_loc);
+          const auto front_funcs = get_function("front", m_front_loc);
+          const auto pop_front_funcs = get_function("pop_front", m_pop_front_loc);
+
+          try {
+            const auto range_obj = call_function(range_funcs, range_expression_result);
+            chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+            Boxed_Value &obj = t_ss.add_get_object(loop_var_name, void_var());
+            const chaiscript::eval::detail::Loop_Params params(t_ss);
+            while (!boxed_cast<bool>(call_function(empty_funcs, range_obj))) {
+              obj = call_function(front_funcs, range_obj);
+              params.release();
+              try {
+                this->children[2]->eval(t_ss);
+                if (detail::end_loop_iteration(t_ss)) {
+                  break;
                 }
-                call_function(pop_front_funcs, range_obj);
+              } catch (detail::Continue_Loop &) {
               }
-            } catch (detail::Break_Loop &) {
-              // loop broken
+              call_function(pop_front_funcs, range_obj);
             }
-            return void_var();
+          } catch (detail::Break_Loop &) {
+            // loop broken
           }
+          return void_var();
 
         }
 
@@ -892,14 +1163,20 @@ namespace chaiscript
           chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
 
           try {
+            this->children[0]->eval(t_ss);
+            const chaiscript::eval::detail::Loop_Params params(t_ss);
             for (
-                this->children[0]->eval(t_ss);
+                ;
                 this->get_scoped_bool_condition(*this->children[1], t_ss);
                 this->children[2]->eval(t_ss)
                 ) {
+              params.release();
               try {
                 // Body of Loop
                 this->children[3]->eval(t_ss);
+                if (detail::end_loop_iteration(t_ss)) {
+                  break;
+                }
               } catch (detail::Continue_Loop &) {
                 // we got a continue exception, which means all of the remaining 
                 // loop implementation is skipped and we just need to continue to
@@ -934,7 +1211,7 @@ namespace chaiscript
               if (this->children[currentCase]->identifier == AST_Node_Type::Case) {
                 //This is a little odd, but because want to see both the switch and the case simultaneously, I do a downcast here.
                 try {
-                  if (hasMatched || boxed_cast<bool>(t_ss->call_function("==", m_loc, {match_value, this->children[currentCase]->children[0]->eval(t_ss)}, t_ss.conversions()))) {
+                  if (hasMatched || boxed_cast<bool>(t_ss->call_function("==", m_loc, std::array<Boxed_Value, 2>{{match_value, this->children[currentCase]->children[0]->eval(t_ss)}}, t_ss.conversions()))) {
                     this->children[currentCase]->eval(t_ss);
                     hasMatched = true;
                   }
@@ -951,6 +1228,14 @@ namespace chaiscript
             catch (detail::Break_Loop &) {
               breaking = true;
             }
+
+            if (t_ss.stack_holder().control_flow == chaiscript::detail::Control_Flow::break_loop) {
+              detail::set_control_flow(t_ss, chaiscript::detail::Control_Flow::none);
+              breaking = true;
+            } else if (detail::control_flow_pending(t_ss)) {
+              // return or continue, handled by the enclosing function or loop
+              break;
+            }
             ++currentCase;
           }
           return void_var();
@@ -1003,7 +1288,7 @@ namespace chaiscript
               for (const auto &child : this->children[0]->children) {
                 auto obj = child->eval(t_ss);
                 if (!obj.is_return_value()) {
-                  vec.push_back(t_ss->call_function("clone", m_loc, {obj}, t_ss.conversions()));
+                  vec.push_back(t_ss->call_function("clone", m_loc, Function_Params{obj}, t_ss.conversions()));
                 } else {
                   vec.push_back(std::move(obj));
                 }
@@ -1033,7 +1318,7 @@ namespace chaiscript
             for (const auto &child : this->children[0]->children) {
               auto obj = child->children[1]->eval(t_ss);
               if (!obj.is_return_value()) {
-                obj = t_ss->call_function("clone", m_loc, {obj}, t_ss.conversions());
+                obj = t_ss->call_function("clone", m_loc, Function_Params{obj}, t_ss.conversions());
               }
 
               retval[t_ss->boxed_cast<std::string>(child->children[0]->eval(t_ss))] = std::move(obj);
@@ -1057,11 +1342,12 @@ namespace chaiscript
 
         Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
           if (!this->children.empty()) {
-            throw detail::Return_Value(this->children[0]->eval(t_ss));
+            detail::set_return_value(t_ss, this->children[0]->eval(t_ss));
           }
           else {
-            throw detail::Return_Value(void_var());
+            detail::set_return_value(t_ss, void_var());
           }
+          return void_var();
         }
     };
 
@@ -1077,8 +1363,20 @@ namespace chaiscript
             if (num_children > 0) {
               for (size_t i = 0; i < num_children-1; ++i) {
                 this->children[i]->eval(t_ss);
+                if (detail::control_flow_pending(t_ss)) {
+                  break;
+                }
+              }
+
+              auto retval = detail::control_flow_pending(t_ss) ? void_var() : this->children.back()->eval(t_ss);
+              if (t_ss.stack_holder().control_flow == chaiscript::detail::Control_Flow::continue_loop) {
+                detail::set_control_flow(t_ss, chaiscript::detail::Control_Flow::none);
+                throw detail::Continue_Loop();
+              } else if (t_ss.stack_holder().control_flow == chaiscript::detail::Control_Flow::break_loop) {
+                detail::set_control_flow(t_ss, chaiscript::detail::Control_Flow::none);
+                throw detail::Break_Loop();
               }
-              return this->children.back()->eval(t_ss);
+              return retval;
             } else {
               return void_var();
             }
@@ -1120,8 +1418,8 @@ namespace chaiscript
               return Boxed_Number::do_oper(m_oper, bv);
             } else {
               chaiscript::eval::detail::Function_Push_Pop fpp(t_ss);
-              fpp.save_params({bv});
-              return t_ss->call_function(this->text, m_loc, {std::move(bv)}, t_ss.conversions());
+              fpp.save_params(Function_Params{bv});
+              return t_ss->call_function(this->text, m_loc, Function_Params{bv}, t_ss.conversions());
             }
           } catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Error with prefix operator evaluation: '" + this->text + "'", e.parameters, e.functions, false, *t_ss);
@@ -1138,8 +1436,9 @@ namespace chaiscript
         Break_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Break, std::move(t_loc), std::move(t_children)) { }
 
-        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &) const override{
-          throw detail::Break_Loop();
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
+          detail::set_control_flow(t_ss, chaiscript::detail::Control_Flow::break_loop);
+          return void_var();
         }
     };
 
@@ -1148,8 +1447,9 @@ namespace chaiscript
         Continue_AST_Node(std::string t_ast_node_text, Parse_Location t_loc, std::vector<AST_Node_Impl_Ptr<T>> t_children) :
           AST_Node_Impl<T>(std::move(t_ast_node_text), AST_Node_Type::Continue, std::move(t_loc), std::move(t_children)) { }
 
-        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &) const override{
-          throw detail::Continue_Loop();
+        Boxed_Value eval_internal(const chaiscript::detail::Dispatch_State &t_ss) const override{
+          detail::set_control_flow(t_ss, chaiscript::detail::Control_Flow::continue_loop);
+          return void_var();
         }
     };
 
@@ -1188,7 +1488,7 @@ namespace chaiscript
           try {
             auto oper1 = this->children[0]->children[0]->children[0]->eval(t_ss);
             auto oper2 = this->children[0]->children[0]->children[1]->eval(t_ss);
-            return t_ss->call_function("generate_range", m_loc, {oper1, oper2}, t_ss.conversions());
+            return t_ss->call_function("generate_range", m_loc, std::array<Boxed_Value, 2>{{oper1, oper2}}, t_ss.conversions());
           }
           catch (const exception::dispatch_error &e) {
             throw exception::eval_error("Unable to generate range vector, while calling 'generate_range'", e.parameters, e.functions, false, *t_ss);
@@ -1226,7 +1526,7 @@ namespace chaiscript
 
               if (dispatch::Param_Types(
                     std::vector<std::pair<std::string, Type_Info>>{Arg_List_AST_Node<T>::get_arg_type(catch_block->children[0], t_ss)}
-                    ).match(std::vector<Boxed_Value>{t_except}, t_ss.conversions()).first)
+                    ).match(Function_Params{t_except}, t_ss.conversions()).first)
               {
                 t_ss.add_object(name, t_except);
 
@@ -1298,7 +1598,19 @@ namespace chaiscript
 
 
           if (this->children.back()->identifier == AST_Node_Type::Finally) {
+            // a return, break or continue from the try or catch blocks is completed
+            // after the finally block, unless that has control flow of its own
+            auto &holder = t_ss.stack_holder();
+            const auto flow = holder.control_flow;
+            auto pending_retval = std::move(holder.return_value);
+            holder.control_flow = chaiscript::detail::Control_Flow::none;
+
             retval = this->children.back()->children[0]->eval(t_ss);
+
+            if (holder.control_flow == chaiscript::detail::Control_Flow::none) {
+              holder.control_flow = flow;
+              holder.return_value = std::move(pending_retval);
+            }
           }
 
           return retval;
@@ -1354,11 +1666,11 @@ namespace chaiscript
           const size_t numparams = t_param_names.size();
 
           std::shared_ptr<dispatch::Proxy_Function_Base> guard;
-          std::reference_wrapper<chaiscript::detail::Dispatch_Engine> engine(*t_ss);
+          const detail::Defining_Engine engine(*t_ss);
           if (guardnode) {
             guard = dispatch::make_dynamic_proxy_function(
-                [engine, t_param_names, guardnode](const std::vector<Boxed_Value> &t_params) {
-                  return chaiscript::eval::detail::eval_function(engine, guardnode, t_param_names, t_params);
+                [engine, t_param_names, guardnode, layout = m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions) {
+                  return chaiscript::eval::detail::eval_function(engine.get(t_conversions), guardnode, t_param_names, t_params, nullptr, layout);
                 }, 
                 static_cast<int>(numparams), guardnode);
           }
@@ -1373,8 +1685,8 @@ namespace chaiscript
               t_ss->add(
                   std::make_shared<dispatch::detail::Dynamic_Object_Constructor>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                        [engine, t_param_names, node](const std::vector<Boxed_Value> &t_params) {
-                          return chaiscript::eval::detail::eval_function(engine, node, t_param_names, t_params);
+                        [engine, t_param_names, node, layout = m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions) {
+                          return chaiscript::eval::detail::eval_function(engine.get(t_conversions), node, t_param_names, t_params, nullptr, layout);
                         },
                         static_cast<int>(numparams), node, param_types, guard
                       )
@@ -1389,8 +1701,8 @@ namespace chaiscript
 
               t_ss->add(std::make_shared<dispatch::detail::Dynamic_Object_Function>(class_name,
                     dispatch::make_dynamic_proxy_function(
-                      [engine, t_param_names, node](const std::vector<Boxed_Value> &t_params) {
-                        return chaiscript::eval::detail::eval_function(engine, node, t_param_names, t_params);
+                      [engine, t_param_names, node, layout = m_layout](const Function_Params &t_params, const Type_Conversions_State &t_conversions) {
+                        return chaiscript::eval::detail::eval_function(engine.get(t_conversions), node, t_param_names, t_params, nullptr, layout);
                       },
                       static_cast<int>(numparams), node, param_types, guard), type), 
                   function_name);
@@ -1401,6 +1713,18 @@ namespace chaiscript
           return void_var();
         }
 
+        /// Stores `this` and the parameters in the frame's slots, see chaiscript::detail::Frame_Layout.
+        /// t_names are the names the slots were resolved for.
+        void set_frame_layout(const chaiscript::detail::Frame_Layout &t_layout, const std::vector<std::string> &t_names) {
+          assert(t_names.size() == t_layout.params && t_names == detail::frame_slot_names(
+                (this->children.size() > 3 && this->children[2]->identifier == AST_Node_Type::Arg_List)
+                  ? Arg_List_AST_Node<T>::get_arg_names(this->children[2]) : std::vector<std::string>()));
+          (void)t_names;
+          m_layout = t_layout;
+        }
+
+      private:
+        chaiscript::detail::Frame_Layout m_layout;
     };
 
     template<typename T>
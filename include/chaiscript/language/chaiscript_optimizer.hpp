@@ -7,7 +7,17 @@
 #ifndef CHAISCRIPT_OPTIMIZER_HPP_
 #define CHAISCRIPT_OPTIMIZER_HPP_
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
 #include "chaiscript_eval.hpp"
+#include "chaiscript_bytecode.hpp"
 
 
 namespace chaiscript {
@@ -342,83 +352,639 @@ namespace chaiscript {
       }
     };
 
+    template<typename T>
+      const eval::AST_Node_Impl_Ptr<T> &original_node(const eval::AST_Node_Impl_Ptr<T> &node) {
+        if (node->identifier == AST_Node_Type::Compiled) {
+          return dynamic_cast<const eval::Compiled_AST_Node<T>&>(*node).m_original_node;
+        } else {
+          return node;
+        }
+      }
+
+    /// Calls t_func on every node that is evaluated in the same function frame as t_node,
+    /// nested function bodies are skipped but lambda captures are not
+    template<typename T, typename Callable>
+      void visit_frame(const eval::AST_Node_Impl_Ptr<T> &t_node, const Callable &t_func) {
+        const auto &node = original_node(t_node);
+        t_func(node);
+
+        switch (node->identifier) {
+          case AST_Node_Type::Def:
+          case AST_Node_Type::Method:
+          case AST_Node_Type::Class:
+            return;
+          case AST_Node_Type::Lambda:
+            visit_frame(node->children[0], t_func);
+            return;
+          default:
+            for (const auto &child : node->children) {
+              visit_frame(child, t_func);
+            }
+        }
+      }
+
+    /// A For loop whose condition compares its variable against a bound and whose step
+    /// adds or subtracts a constant. The loop variable stays a single Boxed_Value for the
+    /// whole loop, the condition and the step work on the number it holds directly. If the
+    /// variable or the bound ever holds a type that is not handled natively the rest of the
+    /// loop is evaluated exactly like For_AST_Node does.
+    template<typename T>
+    class Counted_Loop
+    {
+      public:
+        Counted_Loop(eval::AST_Node_Impl_Ptr<T> t_id, eval::AST_Node_Impl_Ptr<T> t_bound, eval::AST_Node_Impl_Ptr<T> t_cond,
+            const Operators::Opers t_compare, const bool t_flipped, Boxed_Value t_step, const bool t_decrement)
+          : m_id(std::move(t_id)),
+            m_bound_node(std::move(t_bound)),
+            m_cond(std::move(t_cond)),
+            m_compare(t_compare),
+            m_flipped(t_flipped),
+            m_step(std::move(t_step)),
+            m_decrement(t_decrement)
+        {
+          if (m_bound_node->identifier == AST_Node_Type::Constant) {
+            m_bound = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(m_bound_node)->m_value;
+            m_bound_node.reset();
+          }
+        }
+
+        /// children are the init, condition, step and body nodes of the For
+        Boxed_Value run(const std::vector<eval::AST_Node_Impl_Ptr<T>> &children, const chaiscript::detail::Dispatch_State &t_ss) const
+        {
+          chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
+
+          try {
+            children[0]->eval(t_ss);
+            const eval::detail::Loop_Params params(t_ss);
+            const Boxed_Value var = m_id->eval(t_ss);
+            const auto &ti = var.get_type_info();
+
+            Resume resume = Resume::condition;
+            if (ti.bare_equal_type_info(typeid(int))) {
+              resume = loop<int>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(unsigned int))) {
+              resume = loop<unsigned int>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(long))) {
+              resume = loop<long>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(unsigned long))) {
+              resume = loop<unsigned long>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(long long))) {
+              resume = loop<long long>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(unsigned long long))) {
+              resume = loop<unsigned long long>(children, t_ss, var, params);
+            } else if (ti.bare_equal_type_info(typeid(double))) {
+              resume = loop<double>(children, t_ss, var, params);
+            }
+
+            // everything the native loop did not handle
+            for (; resume != Resume::finished; resume = Resume::step) {
+              if (resume == Resume::step) {
+                children[2]->eval(t_ss);
+              }
+
+              if (resume != Resume::body && !eval::AST_Node_Impl<T>::get_scoped_bool_condition(*children[1], t_ss)) {
+                break;
+              }
+
+              if (run_body(children[3], t_ss, params)) {
+                break;
+              }
+            }
+          } catch (eval::detail::Break_Loop &) {
+            // loop broken
+          }
+
+          return void_var();
+        }
+
+      private:
+        /// Where the generic loop picks up after the native loop gave up
+        enum class Resume { finished, condition, body, step };
+
+        template<typename N>
+          using Compare = bool (*)(Operators::Opers, N, const Boxed_Value &);
+
+        static bool run_body(const eval::AST_Node_Impl_Ptr<T> &t_body, const chaiscript::detail::Dispatch_State &t_ss,
+            const eval::detail::Loop_Params &t_params)
+        {
+          t_params.release();
+          try {
+            t_body->eval(t_ss);
+            return eval::detail::end_loop_iteration(t_ss);
+          } catch (eval::detail::Continue_Loop &) {
+            // skip the rest of the body and carry on with the step
+            return false;
+          }
+        }
+
+        template<typename N>
+          static bool holds(const Boxed_Value &t_bv)
+          {
+            return t_bv.get_type_info().bare_equal_type_info(typeid(N)) && !t_bv.is_const();
+          }
+
+        /// Compares the way Boxed_Number does, in the common type of both operands
+        template<typename N, typename B>
+          static bool compare(const Operators::Opers t_oper, const N t_lhs, const Boxed_Value &t_rhs)
+          {
+            typedef typename std::common_type<N, B>::type common_type;
+            return compare_values(t_oper, static_cast<common_type>(t_lhs), static_cast<common_type>(*static_cast<const B *>(t_rhs.get_const_ptr())));
+          }
+
+        template<typename C>
+          static bool compare_values(const Operators::Opers t_oper, const C lhs, const C rhs)
+          {
+            switch (t_oper) {
+              case Operators::Opers::less_than:
+                return lhs < rhs;
+              case Operators::Opers::less_than_equal:
+                return lhs <= rhs;
+              case Operators::Opers::greater_than:
+                return lhs > rhs;
+              case Operators::Opers::greater_than_equal:
+                return lhs >= rhs;
+              default:
+                return lhs != rhs;
+            }
+          }
+
+        template<typename N>
+          static Compare<N> comparison(const Type_Info &t_ti)
+          {
+            if (t_ti.bare_equal_type_info(typeid(int))) {
+              return &compare<N, int>;
+            } else if (t_ti.bare_equal_type_info(typeid(unsigned int))) {
+              return &compare<N, unsigned int>;
+            } else if (t_ti.bare_equal_type_info(typeid(long))) {
+              return &compare<N, long>;
+            } else if (t_ti.bare_equal_type_info(typeid(unsigned long))) {
+              return &compare<N, unsigned long>;
+            } else if (t_ti.bare_equal_type_info(typeid(long long))) {
+              return &compare<N, long long>;
+            } else if (t_ti.bare_equal_type_info(typeid(unsigned long long))) {
+              return &compare<N, unsigned long long>;
+            } else if (t_ti.bare_equal_type_info(typeid(double))) {
+              return &compare<N, double>;
+            } else {
+              return nullptr;
+            }
+          }
+
+        /// Evaluates the condition for a bound that has already been evaluated
+        Resume generic_compare(const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_var, const Boxed_Value &t_bound) const
+        {
+          const auto &cond = static_cast<const eval::Binary_Operator_AST_Node<T> &>(*m_cond);
+          const auto result = m_flipped?cond.do_oper(t_ss, Operators::to_operator(cond.text), cond.text, t_bound, t_var)
+                                       :cond.do_oper(t_ss, Operators::to_operator(cond.text), cond.text, t_var, t_bound);
+          return eval::AST_Node_Impl<T>::get_bool_condition(result, t_ss) ? Resume::body : Resume::finished;
+        }
+
+        template<typename N>
+          Resume loop(const std::vector<eval::AST_Node_Impl_Ptr<T>> &children, const chaiscript::detail::Dispatch_State &t_ss, const Boxed_Value &t_var,
+              const eval::detail::Loop_Params &t_params) const
+          {
+            if (!std::is_floating_point<N>::value && !m_step.get_type_info().bare_equal_type_info(typeid(int))) {
+              return Resume::condition;
+            }
+
+            const auto step = Boxed_Number(m_step).get_as<N>();
+
+            Compare<N> cmp = nullptr;
+            const std::type_info *cmp_type = nullptr;
+            if (!m_bound_node) {
+              cmp = comparison<N>(m_bound.get_type_info());
+              if (!cmp) {
+                return Resume::condition;
+              }
+            }
+
+            if (!holds<N>(t_var)) {
+              return Resume::condition;
+            }
+
+            auto *i = static_cast<N *>(t_var.get_ptr());
+            Boxed_Value evaluated;
+
+            // a constant bound of the same type is compared without looking at its type again
+            const N *limit = !m_bound_node && m_bound.get_type_info().bare_equal_type_info(typeid(N))
+              ? static_cast<const N *>(m_bound.get_const_ptr()) : nullptr;
+
+            for (;;) {
+              // the bound is evaluated before the variable is read, just like the condition would
+              if (m_bound_node) {
+                evaluated = m_bound_node->eval(t_ss);
+                const auto *type = evaluated.get_type_info().bare_type_info();
+                if (type != cmp_type) {
+                  cmp = comparison<N>(evaluated.get_type_info());
+                  cmp_type = type;
+                }
+
+                if (!cmp || !holds<N>(t_var)) {
+                  return generic_compare(t_ss, t_var, evaluated);
+                }
+                i = static_cast<N *>(t_var.get_ptr());
+              }
+
+              if (!(limit ? compare_values(m_compare, *i, *limit) : cmp(m_compare, *i, m_bound_node?evaluated:m_bound))) {
+                return Resume::finished;
+              }
+
+              if (run_body(children[3], t_ss, t_params)) {
+                return Resume::finished;
+              }
+
+              // the body may have replaced the variable
+              if (!holds<N>(t_var)) {
+                return Resume::step;
+              }
+
+              i = static_cast<N *>(t_var.get_ptr());
+              if (m_decrement) {
+                *i -= step;
+              } else {
+                *i += step;
+              }
+            }
+          }
+
+        eval::AST_Node_Impl_Ptr<T> m_id;
+        eval::AST_Node_Impl_Ptr<T> m_bound_node;
+        eval::AST_Node_Impl_Ptr<T> m_cond;
+        Boxed_Value m_bound;
+        Operators::Opers m_compare;
+        bool m_flipped;
+        Boxed_Value m_step;
+        bool m_decrement;
+    };
+
     struct For_Loop {
       template<typename T>
       auto optimize(const eval::AST_Node_Impl_Ptr<T> &for_node) {
 
-        if (for_node->identifier != AST_Node_Type::For) {
+        if (for_node->identifier != AST_Node_Type::For || child_count(for_node) != 4) {
           return for_node;
         }
 
-        const auto eq_node = child_at(for_node, 0);
-        const auto binary_node = child_at(for_node, 1);
-        const auto prefix_node = child_at(for_node, 2);
-
-        if (eq_node->identifier == AST_Node_Type::Equation
-            && child_count(eq_node) == 2
-            && child_at(eq_node, 0)->identifier == AST_Node_Type::Var_Decl
-            && child_at(eq_node, 1)->identifier == AST_Node_Type::Constant
-            && binary_node->identifier == AST_Node_Type::Binary
-            && binary_node->text == "<"
-            && child_count(binary_node) == 2
-            && child_at(binary_node, 0)->identifier == AST_Node_Type::Id
-            && child_at(binary_node, 0)->text == child_at(child_at(eq_node,0), 0)->text
-            && child_at(binary_node, 1)->identifier == AST_Node_Type::Constant
-            && prefix_node->identifier == AST_Node_Type::Prefix
-            && prefix_node->text == "++"
-            && child_count(prefix_node) == 1
-            && child_at(prefix_node, 0)->identifier == AST_Node_Type::Id
-            && child_at(prefix_node, 0)->text == child_at(child_at(eq_node,0), 0)->text)
-        {
-          const Boxed_Value &begin = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(child_at(eq_node, 1))->m_value;
-          const Boxed_Value &end = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(child_at(binary_node, 1))->m_value;
-          const std::string &id = child_at(prefix_node, 0)->text;
-
-          if (begin.get_type_info().bare_equal(user_type<int>()) 
-              && end.get_type_info().bare_equal(user_type<int>())) {
-
-            const auto start_int = boxed_cast<int>(begin);
-            const auto end_int = boxed_cast<int>(end);
-
-            const auto body = child_at(for_node, 3);
-
-            return make_compiled_node(for_node, {body}, 
-                [id, start_int, end_int](const std::vector<eval::AST_Node_Impl_Ptr<T>> &children, const chaiscript::detail::Dispatch_State &t_ss) {
-                  assert(children.size() == 1);
-                  chaiscript::eval::detail::Scope_Push_Pop spp(t_ss);
-
-                  int i = start_int;
-                  t_ss.add_object(id, var(&i));
-
-                  try {
-                    for (; i < end_int; ++i) {
-                      try {
-                        // Body of Loop
-                        children[0]->eval(t_ss);
-                      } catch (eval::detail::Continue_Loop &) {
-                        // we got a continue exception, which means all of the remaining 
-                        // loop implementation is skipped and we just need to continue to
-                        // the next iteration step
-                      }
-                    }
-                  } catch (eval::detail::Break_Loop &) {
-                    // loop broken
-                  }
+        const auto init_node = child_at(for_node, 0);
+        const auto cond_node = child_at(for_node, 1);
+        const auto step_node = child_at(for_node, 2);
+
+        // var i = <expr> or i = <expr>
+        if (init_node->identifier != AST_Node_Type::Equation
+            || init_node->text != "="
+            || child_count(init_node) != 2) {
+          return for_node;
+        }
+
+        const auto target = child_at(init_node, 0);
+        const std::string &id = target->identifier == AST_Node_Type::Var_Decl ? child_at(target, 0)->text : target->text;
+        if (target->identifier != AST_Node_Type::Id && target->identifier != AST_Node_Type::Var_Decl) {
+          return for_node;
+        }
+
+        const auto is_id = [&id](const eval::AST_Node_Impl_Ptr<T> &node) {
+          return node->identifier == AST_Node_Type::Id && node->text == id;
+        };
+
+        // i <op> <bound> or <bound> <op> i
+        if (cond_node->identifier != AST_Node_Type::Binary || child_count(cond_node) != 2) {
+          return for_node;
+        }
 
-                  return void_var();
+        const auto compare = Operators::to_operator(cond_node->text);
+        if (compare != Operators::Opers::less_than && compare != Operators::Opers::less_than_equal
+            && compare != Operators::Opers::greater_than && compare != Operators::Opers::greater_than_equal
+            && compare != Operators::Opers::not_equal) {
+          return for_node;
+        }
+
+        const bool flipped = !is_id(child_at(cond_node, 0));
+        const auto id_node = cond_node->children[flipped?1:0];
+        const auto bound_node = cond_node->children[flipped?0:1];
+        if (!is_id(original_node(id_node))) {
+          return for_node;
+        }
+
+        // a bound other than a constant is evaluated on every iteration, it must not need the
+        // scope the condition is normally evaluated in
+        bool bound_ok = original_node(bound_node)->identifier == AST_Node_Type::Constant
+          || dynamic_cast<const eval::Binary_Operator_AST_Node<T> *>(cond_node.get()) != nullptr;
+        visit_frame(bound_node, [&bound_ok, &is_id](const eval::AST_Node_Impl_Ptr<T> &node) {
+            switch (node->identifier) {
+              case AST_Node_Type::Var_Decl:
+              case AST_Node_Type::Reference:
+              case AST_Node_Type::Lambda:
+              case AST_Node_Type::Def:
+                bound_ok = false;
+                break;
+              default:
+                if (is_id(node)) {
+                  bound_ok = false;
                 }
-            );
-          } else {
+            }
+          });
+
+        if (!bound_ok) {
+          return for_node;
+        }
+
+        // ++i, --i, i += <constant> or i -= <constant>
+        Boxed_Value step;
+        bool decrement = false;
+        if (step_node->identifier == AST_Node_Type::Prefix
+            && (step_node->text == "++" || step_node->text == "--")
+            && child_count(step_node) == 1
+            && is_id(child_at(step_node, 0))) {
+          step = const_var(1);
+          decrement = step_node->text == "--";
+        } else if (step_node->identifier == AST_Node_Type::Equation
+            && (step_node->text == "+=" || step_node->text == "-=")
+            && child_count(step_node) == 2
+            && is_id(child_at(step_node, 0))
+            && child_at(step_node, 1)->identifier == AST_Node_Type::Constant) {
+          step = std::dynamic_pointer_cast<const eval::Constant_AST_Node<T>>(child_at(step_node, 1))->m_value;
+          decrement = step_node->text == "-=";
+          if (!step.get_type_info().bare_equal_type_info(typeid(int)) && !step.get_type_info().bare_equal_type_info(typeid(double))) {
             return for_node;
           }
         } else {
           return for_node;
         }
+
+        if (flipped) {
+          switch (compare) {
+            case Operators::Opers::less_than:
+              return make_counted_loop(for_node, id_node, bound_node, cond_node, Operators::Opers::greater_than, flipped, step, decrement);
+            case Operators::Opers::less_than_equal:
+              return make_counted_loop(for_node, id_node, bound_node, cond_node, Operators::Opers::greater_than_equal, flipped, step, decrement);
+            case Operators::Opers::greater_than:
+              return make_counted_loop(for_node, id_node, bound_node, cond_node, Operators::Opers::less_than, flipped, step, decrement);
+            case Operators::Opers::greater_than_equal:
+              return make_counted_loop(for_node, id_node, bound_node, cond_node, Operators::Opers::less_than_equal, flipped, step, decrement);
+            default:
+              break;
+          }
+        }
+
+        return make_counted_loop(for_node, id_node, bound_node, cond_node, compare, flipped, step, decrement);
+      }
+
+      template<typename T>
+      static eval::AST_Node_Impl_Ptr<T> make_counted_loop(const eval::AST_Node_Impl_Ptr<T> &for_node, eval::AST_Node_Impl_Ptr<T> id_node,
+          eval::AST_Node_Impl_Ptr<T> bound_node, eval::AST_Node_Impl_Ptr<T> cond_node, const Operators::Opers compare, const bool flipped,
+          Boxed_Value step, const bool decrement)
+      {
+        const auto loop = std::make_shared<const Counted_Loop<T>>(std::move(id_node), std::move(bound_node), std::move(cond_node),
+            compare, flipped, std::move(step), decrement);
+
+        return make_compiled_node(for_node, for_node->children,
+            [loop](const std::vector<eval::AST_Node_Impl_Ptr<T>> &children, const chaiscript::detail::Dispatch_State &t_ss) {
+              assert(children.size() == 4);
+              return loop->run(children, t_ss);
+            }
+        );
+      }
+    };
+
+    /// Lowers the outermost operator expressions below each statement into a single
+    /// Bytecode_Program. Operators are left alone until their parent is a node of another
+    /// kind, so every expression is lowered exactly once and the passes that look for
+    /// operators, such as For_Loop, still see them.
+    struct Bytecode {
+      template<typename T>
+      auto optimize(const eval::AST_Node_Impl_Ptr<T> &node) {
+        if (!is_operator(node) && node->identifier != AST_Node_Type::Compiled) {
+          for (auto &child : node->children) {
+            if (lower_operands(child)) {
+              lower(child);
+            }
+          }
+        }
+
+        return node;
+      }
+
+      private:
+        template<typename T>
+        static bool is_operator(const eval::AST_Node_Impl_Ptr<T> &t_node) {
+          return t_node->identifier == AST_Node_Type::Binary || t_node->identifier == AST_Node_Type::Prefix;
+        }
+
+        /// \returns true if t_node is made up of only operators, identifiers and constants.
+        /// Otherwise the largest such operands of its operators are lowered on their own.
+        template<typename T>
+        static bool lower_operands(const eval::AST_Node_Impl_Ptr<T> &t_node) {
+          if (!is_operator(t_node)) {
+            return t_node->identifier == AST_Node_Type::Constant || t_node->identifier == AST_Node_Type::Id;
+          }
+
+          std::vector<bool> pure_children;
+          for (const auto &child : t_node->children) {
+            pure_children.push_back(lower_operands(child));
+          }
+
+          if (std::find(pure_children.begin(), pure_children.end(), false) == pure_children.end()) {
+            return true;
+          }
+
+          for (size_t i = 0; i < pure_children.size(); ++i) {
+            if (pure_children[i]) {
+              lower(t_node->children[i]);
+            }
+          }
+          return false;
+        }
+
+        /// Replaces the operator expression t_node with its program, or lowers its operands if
+        /// it is too small or too deep to be one
+        template<typename T>
+        static void lower(eval::AST_Node_Impl_Ptr<T> &t_node) {
+          if (!is_operator(t_node)) {
+            return;
+          }
+
+          if (const auto program = eval::Bytecode_Program<T>::compile(t_node)) {
+            t_node = make_compiled_node(t_node, t_node->children,
+                [program](const std::vector<eval::AST_Node_Impl_Ptr<T>> &, const chaiscript::detail::Dispatch_State &t_ss) {
+                  return program->run(t_ss);
+                }
+            );
+          } else {
+            for (auto &child : t_node->children) {
+              lower(child);
+            }
+          }
+        }
+    };
+
+    /// Binds the identifiers of a function that name its `this`, captures, parameters
+    /// or top level locals to fixed slots in the function's frame, so that they are
+    /// found with an indexed load instead of a search by name
+    struct Frame_Slots {
+      template<typename T>
+      auto optimize(const eval::AST_Node_Impl_Ptr<T> &node) {
+        std::vector<std::string> params;
+        std::vector<std::string> captures;
+        eval::AST_Node_Impl_Ptr<T> guard;
+
+        if (node->identifier == AST_Node_Type::Def) {
+          if (node->children.size() > 2 && node->children[1]->identifier == AST_Node_Type::Arg_List) {
+            params = eval::Arg_List_AST_Node<T>::get_arg_names(node->children[1]);
+            if (node->children.size() > 3) {
+              guard = node->children[2];
+            }
+          } else if (node->children.size() > 2) {
+            guard = node->children[1];
+          }
+        } else if (node->identifier == AST_Node_Type::Method) {
+          params.push_back("this");
+          if (node->children.size() > 3 && node->children[2]->identifier == AST_Node_Type::Arg_List) {
+            const auto args = eval::Arg_List_AST_Node<T>::get_arg_names(node->children[2]);
+            params.insert(params.end(), args.begin(), args.end());
+            if (node->children.size() > 4) {
+              guard = node->children[3];
+            }
+          } else if (node->children.size() > 3) {
+            guard = node->children[2];
+          }
+        } else if (node->identifier == AST_Node_Type::Lambda) {
+          for (const auto &capture : node->children[0]->children) {
+            captures.push_back(capture->children[0]->text);
+          }
+          std::sort(captures.begin(), captures.end());
+          captures.erase(std::unique(captures.begin(), captures.end()), captures.end());
+          params = eval::Arg_List_AST_Node<T>::get_arg_names(node->children[1]);
+        } else {
+          return node;
+        }
+
+        const auto &body = node->children.back();
+
+        // eval_function stores `this`, the captures in map order, then the
+        // parameters in the first slots of the frame. Without parameters
+        // whether `this` exists depends on the caller.
+        std::vector<std::string> layout;
+        if (!params.empty()) {
+          layout.push_back("this");
+          layout.insert(layout.end(), captures.begin(), captures.end());
+          std::copy_if(params.begin(), params.end(), std::back_inserter(layout),
+              [](const std::string &t_name) { return t_name != "this"; });
+
+          auto sorted = layout;
+          std::sort(sorted.begin(), sorted.end());
+          if (std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end()) {
+            // the call itself fails with a name conflict
+            layout.clear();
+          }
+        }
+
+        std::map<std::string, size_t> declared;
+        bool dynamic_scope = false;
+        const auto collect = [&](const eval::AST_Node_Impl_Ptr<T> &t_node) {
+          switch (t_node->identifier) {
+            case AST_Node_Type::Var_Decl:
+            case AST_Node_Type::Reference:
+            case AST_Node_Type::Ranged_For:
+              ++declared[t_node->children[0]->text];
+              break;
+            case AST_Node_Type::Catch:
+              if (t_node->children.size() > 1) {
+                ++declared[eval::Arg_List_AST_Node<T>::get_arg_name(t_node->children[0])];
+              }
+              break;
+            case AST_Node_Type::Id:
+              // these can add objects to any scope at runtime
+              if (t_node->text == "eval" || t_node->text == "eval_file" || t_node->text == "use") {
+                dynamic_scope = true;
+              }
+              break;
+            default:
+              break;
+          }
+        };
+
+        visit_frame(body, collect);
+        if (guard) {
+          visit_frame(guard, collect);
+        }
+
+        if (dynamic_scope) {
+          return node;
+        }
+
+        // `this`, the captures and the parameters go to the first slots when no
+        // declaration in the function can shadow them, the call adds them by name otherwise
+        if (!layout.empty() && std::none_of(layout.begin(), layout.end(),
+              [&declared](const std::string &t_name) { return declared.count(t_name) != 0; })) {
+          const auto resolve = [&layout](const void *t_owner) {
+            return [&layout, t_owner](const eval::AST_Node_Impl_Ptr<T> &t_node) {
+              if (t_node->identifier != AST_Node_Type::Id) { return; }
+
+              const auto itr = std::find(layout.begin(), layout.end(), t_node->text);
+              if (itr != layout.end()) {
+                if (auto id = dynamic_cast<eval::Id_AST_Node<T> *>(t_node.get())) {
+                  id->set_frame_slot({t_owner, static_cast<uint_fast32_t>(std::distance(layout.begin(), itr))});
+                }
+              }
+            };
+          };
+
+          visit_frame(body, resolve(body.get()));
+          if (guard) {
+            visit_frame(guard, resolve(guard.get()));
+          }
+
+          const chaiscript::detail::Frame_Layout frame_layout{static_cast<uint_fast32_t>(layout.size())};
+          if (auto def = dynamic_cast<eval::Def_AST_Node<T> *>(node.get())) {
+            def->set_frame_layout(frame_layout, layout);
+          } else if (auto method = dynamic_cast<eval::Method_AST_Node<T> *>(node.get())) {
+            method->set_frame_layout(frame_layout, layout);
+          } else if (auto lambda = dynamic_cast<eval::Lambda_AST_Node<T> *>(node.get())) {
+            lambda->set_frame_layout(frame_layout, layout);
+          }
+        } else {
+          layout.clear();
+        }
+
+        // variables declared once, by a top level statement of a block body, take the
+        // following slots in order. Their identifiers in the declaring statement and
+        // after it are resolved, one evaluated before the declaration finds the slot
+        // not stored yet and looks the name up instead.
+        if (body->identifier == AST_Node_Type::Block) {
+          auto index = static_cast<uint_fast32_t>(layout.size());
+          for (size_t i = 0; i < body->children.size(); ++i) {
+            const auto &statement = body->children[i];
+            const auto &decl = (statement->identifier == AST_Node_Type::Equation) ? statement->children[0] : statement;
+            if (decl->identifier != AST_Node_Type::Var_Decl) { continue; }
+
+            const auto &name = decl->children[0]->text;
+            if (declared[name] != 1) { continue; }
+
+            auto var_decl = dynamic_cast<eval::Var_Decl_AST_Node<T> *>(decl.get());
+            if (!var_decl) { continue; }
+
+            const chaiscript::detail::Frame_Slot slot{body.get(), index++};
+            var_decl->set_frame_slot(slot);
+
+            for (size_t j = i; j < body->children.size(); ++j) {
+              visit_frame(body->children[j], [&name, &slot](const eval::AST_Node_Impl_Ptr<T> &t_node) {
+                  if (t_node->identifier == AST_Node_Type::Id && t_node->text == name) {
+                    if (auto id = dynamic_cast<eval::Id_AST_Node<T> *>(t_node.get())) {
+                      id->set_frame_slot(slot);
+                    }
+                  }
+                });
+            }
+          }
+        }
+
+        return node;
       }
     };
 
     typedef Optimizer<optimizer::Partial_Fold, optimizer::Unused_Return, optimizer::Constant_Fold, 
-      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop> Optimizer_Default; 
+      optimizer::If, optimizer::Return, optimizer::Dead_Code, optimizer::Block, optimizer::For_Loop,
+      optimizer::Bytecode, optimizer::Frame_Slots> Optimizer_Default; 
 
   }
 }
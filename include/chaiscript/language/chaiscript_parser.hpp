@@ -22,6 +22,7 @@
 #include "../dispatchkit/boxed_value.hpp"
 #include "chaiscript_common.hpp"
 #include "chaiscript_optimizer.hpp"
+#include "chaiscript_serializer.hpp"
 #include "chaiscript_tracer.hpp"
 #include "../utility/fnv1a.hpp"
 #include "../utility/static_string.hpp"
@@ -269,7 +270,7 @@ namespace chaiscript
       {
         Position() = default;
 
-        Position(std::string::const_iterator t_pos, std::string::const_iterator t_end)
+        Position(const char *t_pos, const char *t_end)
           : line(1), col(1), m_pos(t_pos), m_end(t_end), m_last_col(1)
         {
         }
@@ -358,8 +359,8 @@ namespace chaiscript
         int col = -1;
 
         private:
-          std::string::const_iterator m_pos;
-          std::string::const_iterator m_end;
+          const char *m_pos = nullptr;
+          const char *m_end = nullptr;
           int m_last_col = -1;
       };
 
@@ -2523,10 +2524,27 @@ namespace chaiscript
       }
 
       AST_NodePtr parse(const std::string &t_input, const std::string &t_fname) override
+      {
+        return parse(t_input.data(), t_input.data() + t_input.size(), t_fname);
+      }
+
+      AST_NodePtr parse(const char *t_begin, const char *t_end, const std::string &t_fname) override
       {
         ChaiScript_Parser<Tracer, Optimizer> parser(*this);
         parser.m_match_stack.clear();
-        return parser.parse_internal(t_input, t_fname);
+        return parser.parse_internal(t_begin, t_end, t_fname);
+      }
+
+      bool save(const AST_NodePtr &t_ast, std::string &t_data) const override
+      {
+        const auto ast = std::dynamic_pointer_cast<eval::AST_Node_Impl<Tracer>>(t_ast);
+        return ast && detail::AST_Serializer<Tracer>::write(ast, detail::AST_Serializer<Tracer>::template format<Optimizer>(), t_data);
+      }
+
+      AST_NodePtr load(const std::string &t_data) override
+      {
+        Optimizer optimizer(m_optimizer);
+        return detail::AST_Serializer<Tracer>::read(t_data, detail::AST_Serializer<Tracer>::template format<Optimizer>(), optimizer);
       }
 
       eval::AST_Node_Impl_Ptr<Tracer> parse_instr_eval(const std::string &t_input)
@@ -2535,7 +2553,7 @@ namespace chaiscript
         const auto last_filename    = m_filename;
         const auto last_match_stack = std::exchange(m_match_stack, decltype(m_match_stack){});
 
-        const auto retval = parse_internal(t_input, "instr eval");
+        const auto retval = parse_internal(t_input.data(), t_input.data() + t_input.size(), "instr eval");
 
         m_position = std::move(last_position);
         m_filename = std::move(last_filename);
@@ -2544,12 +2562,13 @@ namespace chaiscript
         return std::dynamic_pointer_cast<eval::AST_Node_Impl<Tracer>>(retval);
       }
 
-      /// Parses the given input string, tagging parsed ast_nodes with the given m_filename.
-      AST_NodePtr parse_internal(const std::string &t_input, std::string t_fname) {
-        m_position = Position(t_input.begin(), t_input.end());
+      /// Parses the characters in [t_begin, t_end), tagging parsed ast_nodes with the given m_filename.
+      /// The characters are not copied, they only need to outlive the call.
+      AST_NodePtr parse_internal(const char *t_begin, const char *t_end, std::string t_fname) {
+        m_position = Position(t_begin, t_end);
         m_filename = std::make_shared<std::string>(std::move(t_fname));
 
-        if ((t_input.size() > 1) && (t_input[0] == '#') && (t_input[1] == '!')) {
+        if ((t_end - t_begin > 1) && (t_begin[0] == '#') && (t_begin[1] == '!')) {
           while (m_position.has_more() && (!Eol())) {
             ++m_position;
           }
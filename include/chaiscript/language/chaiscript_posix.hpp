@@ -7,10 +7,88 @@
 #ifndef CHAISCRIPT_POSIX_HPP_
 #define CHAISCRIPT_POSIX_HPP_
 
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 namespace chaiscript
 {
   namespace detail
   {
+    /// \returns the absolute path of t_filename with symbolic links resolved, or t_filename
+    ///          if the file does not exist
+    inline std::string canonical_path(const std::string &t_filename)
+    {
+      if (char *path = realpath(t_filename.c_str(), nullptr))
+      {
+        std::string result(path);
+        free(path);
+        return result;
+      }
+      return t_filename;
+    }
+
+    /// A script file mapped into memory, so that it is parsed without being copied
+    struct Mapped_File
+    {
+      explicit Mapped_File(const std::string &t_filename)
+      {
+        const int fd = open(t_filename.c_str(), O_RDONLY);
+        if (fd == -1)
+        {
+          throw chaiscript::exception::file_not_found_error(t_filename);
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode))
+        {
+          close(fd);
+          throw chaiscript::exception::file_not_found_error(t_filename);
+        }
+
+        m_size = static_cast<size_t>(info.st_size);
+
+        if (m_size > 0)
+        {
+          void *data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (data == MAP_FAILED)
+          {
+            close(fd);
+            throw chaiscript::exception::file_not_found_error(t_filename);
+          }
+          m_data = static_cast<const char *>(data);
+        }
+
+        // the mapping stays valid once the file is closed
+        close(fd);
+      }
+
+      Mapped_File(const Mapped_File &) = delete;
+      Mapped_File &operator=(const Mapped_File &) = delete;
+
+      ~Mapped_File()
+      {
+        if (m_data != nullptr)
+        {
+          munmap(const_cast<char *>(m_data), m_size);
+        }
+      }
+
+      const char *begin() const
+      {
+        return m_data;
+      }
+
+      const char *end() const
+      {
+        return m_data + m_size;
+      }
+
+      const char *m_data = nullptr;
+      size_t m_size = 0;
+    };
+
     struct Loadable_Module
     {
       struct DLModule
@@ -0,0 +1,400 @@
+// This file is distributed under the BSD License.
+// See "license.txt" for details.
+// Copyright 2009-2012, Jonathan Turner (jonathan@emptycrate.com)
+// Copyright 2009-2016, Jason Turner (jason@emptycrate.com)
+// http://www.chaiscript.com
+
+#ifndef CHAISCRIPT_SERIALIZER_HPP_
+#define CHAISCRIPT_SERIALIZER_HPP_
+
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "../chaiscript_defines.hpp"
+#include "../dispatchkit/boxed_value.hpp"
+#include "../dispatchkit/proxy_functions.hpp"
+#include "chaiscript_common.hpp"
+#include "chaiscript_eval.hpp"
+
+namespace chaiscript
+{
+  namespace parser
+  {
+    namespace detail
+    {
+      /// \brief Binary form of a parsed tree, so that a tree can be kept from one run to the next.
+      ///
+      /// The optimized tree cannot be written as it is: compiled nodes are closures, and
+      /// identifiers bound to frame slots point into the tree. Each compiled node is written
+      /// as the node it was compiled from, and reading gives every node to the optimizer
+      /// again, bottom up, the way the parser does. Constants are written as values, the
+      /// ones the optimizer folded included, so reading a tree lexes and parses nothing.
+      template<typename Tracer>
+      class AST_Serializer
+      {
+        public:
+          /// Written ahead of the tree, a tree written by another version, compiler, tracer or
+          /// optimizer is not read
+          template<typename Optimizer>
+            static std::string format()
+            {
+              return "ChaiScript AST 1 " + Build_Info::version() + ' ' + Build_Info::compiler_id()
+                + ' ' + typeid(Tracer).name() + ' ' + typeid(Optimizer).name();
+            }
+
+          /// Appends t_format and the binary form of t_node to t_data
+          /// \returns false if the tree holds a constant of a type that has no binary form
+          static bool write(const eval::AST_Node_Impl_Ptr<Tracer> &t_node, const std::string &t_format, std::string &t_data)
+          {
+            Writer writer{t_data, {}};
+            writer.string(t_format);
+            return writer.node(t_node);
+          }
+
+          /// \returns the tree written by write(), optimized by t_optimizer, or null if t_data
+          ///          was written in another format or is damaged
+          template<typename Optimizer>
+            static eval::AST_Node_Impl_Ptr<Tracer> read(const std::string &t_data, const std::string &t_format, Optimizer &t_optimizer)
+            {
+              Reader<Optimizer> reader{t_data, 0, {}, t_optimizer};
+              try {
+                if (reader.string() != t_format) {
+                  return nullptr;
+                }
+
+                auto root = reader.node(true);
+                if (reader.pos != t_data.size()) {
+                  return nullptr;
+                }
+                return root;
+              } catch (const std::exception &) {
+                return nullptr;
+              }
+            }
+
+        private:
+          template<typename ... T>
+            struct Types
+            {
+            };
+
+          /// Types a constant can have, tagged by their position after the two tags of their own
+          typedef Types<bool, char, signed char, unsigned char, wchar_t, char16_t, char32_t,
+                  short, unsigned short, int, unsigned int, long, unsigned long, long long, unsigned long long,
+                  float, double, long double> Arithmetic_Types;
+
+          enum Value_Tag { string_tag = 0, placeholder_tag = 1, arithmetic_tag = 2 };
+
+          static const eval::AST_Node_Impl_Ptr<Tracer> &original(const eval::AST_Node_Impl_Ptr<Tracer> &t_node)
+          {
+            if (t_node->identifier == AST_Node_Type::Compiled) {
+              return original(dynamic_cast<const eval::Compiled_AST_Node<Tracer> &>(*t_node).m_original_node);
+            } else {
+              return t_node;
+            }
+          }
+
+          struct Writer
+          {
+            std::string &data;
+            std::map<std::string, size_t> filenames;
+
+            void number(uint64_t t_num)
+            {
+              while (t_num >= 0x80) {
+                data.push_back(static_cast<char>((t_num & 0x7f) | 0x80));
+                t_num >>= 7;
+              }
+              data.push_back(static_cast<char>(t_num));
+            }
+
+            void signed_number(const int t_num)
+            {
+              number(t_num < 0 ? ((static_cast<uint64_t>(-(static_cast<int64_t>(t_num) + 1)) << 1) | 1) : (static_cast<uint64_t>(t_num) << 1));
+            }
+
+            void string(const std::string &t_str)
+            {
+              number(t_str.size());
+              data.append(t_str);
+            }
+
+            void location(const Parse_Location &t_loc)
+            {
+              const auto itr = filenames.find(*t_loc.filename);
+              if (itr != filenames.end()) {
+                number(itr->second);
+              } else {
+                const auto index = filenames.size();
+                number(index);
+                string(*t_loc.filename);
+                filenames.emplace(*t_loc.filename, index);
+              }
+
+              signed_number(t_loc.start.line);
+              signed_number(t_loc.start.column);
+              signed_number(t_loc.end.line);
+              signed_number(t_loc.end.column);
+            }
+
+            bool arithmetic(const Boxed_Value &, const size_t, Types<>)
+            {
+              return false;
+            }
+
+            template<typename T, typename ... Rest>
+              bool arithmetic(const Boxed_Value &t_bv, const size_t t_tag, Types<T, Rest...>)
+              {
+                if (!t_bv.get_type_info().bare_equal_type_info(typeid(T))) {
+                  return arithmetic(t_bv, t_tag + 1, Types<Rest...>());
+                }
+
+                number(t_tag);
+                char bytes[sizeof(T)];
+                std::memcpy(bytes, t_bv.get_const_ptr(), sizeof(T));
+                data.append(bytes, sizeof(T));
+                return true;
+              }
+
+            bool value(const Boxed_Value &t_bv)
+            {
+              if (t_bv.is_undef()) {
+                return false;
+              }
+
+              data.push_back(t_bv.is_const() ? '\1' : '\0');
+
+              if (t_bv.get_type_info().bare_equal_type_info(typeid(std::string))) {
+                number(string_tag);
+                string(*static_cast<const std::string *>(t_bv.get_const_ptr()));
+                return true;
+              } else if (t_bv.get_type_info().bare_equal_type_info(typeid(dispatch::Placeholder_Object))) {
+                number(placeholder_tag);
+                return true;
+              } else {
+                return arithmetic(t_bv, arithmetic_tag, Arithmetic_Types());
+              }
+            }
+
+            bool node(const eval::AST_Node_Impl_Ptr<Tracer> &t_node)
+            {
+              const auto &orig = original(t_node);
+
+              // the single arguments of a parameter list share its identifier, but not its type
+              const auto type = dynamic_cast<const eval::Arg_AST_Node<Tracer> *>(orig.get()) ? AST_Node_Type::Arg : orig->identifier;
+              number(static_cast<uint64_t>(type));
+              string(orig->text);
+              location(orig->location);
+
+              if (orig->identifier == AST_Node_Type::Constant
+                  && !value(dynamic_cast<const eval::Constant_AST_Node<Tracer> &>(*orig).m_value)) {
+                return false;
+              }
+
+              number(orig->children.size());
+              for (const auto &child : orig->children) {
+                if (!node(child)) {
+                  return false;
+                }
+              }
+
+              return true;
+            }
+          };
+
+          template<typename Optimizer>
+            struct Reader
+            {
+              const std::string &data;
+              size_t pos;
+              std::vector<std::shared_ptr<std::string>> filenames;
+              Optimizer &optimizer;
+
+              uint64_t number()
+              {
+                uint64_t num = 0;
+                for (unsigned shift = 0; shift < 64; shift += 7) {
+                  const auto byte = static_cast<unsigned char>(data.at(pos++));
+                  num |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                  if ((byte & 0x80) == 0) {
+                    return num;
+                  }
+                }
+                throw std::out_of_range("Malformed number in serialized AST");
+              }
+
+              int signed_number()
+              {
+                const auto num = number();
+                return (num & 1) ? static_cast<int>(-static_cast<int64_t>(num >> 1) - 1) : static_cast<int>(num >> 1);
+              }
+
+              std::string string()
+              {
+                const auto size = number();
+                if (size > data.size() - pos) {
+                  throw std::out_of_range("Truncated string in serialized AST");
+                }
+                auto str = data.substr(pos, static_cast<size_t>(size));
+                pos += static_cast<size_t>(size);
+                return str;
+              }
+
+              Parse_Location location()
+              {
+                const auto index = number();
+                if (index == filenames.size()) {
+                  filenames.push_back(std::make_shared<std::string>(string()));
+                } else if (index > filenames.size()) {
+                  throw std::out_of_range("Unknown file in serialized AST");
+                }
+
+                auto filename = filenames[static_cast<size_t>(index)];
+                const auto start_line = signed_number();
+                const auto start_col = signed_number();
+                const auto end_line = signed_number();
+                const auto end_col = signed_number();
+                return Parse_Location(std::move(filename), start_line, start_col, end_line, end_col);
+              }
+
+              Boxed_Value arithmetic(const bool, const size_t, const size_t, Types<>)
+              {
+                throw std::out_of_range("Unknown constant type in serialized AST");
+              }
+
+              template<typename T, typename ... Rest>
+                Boxed_Value arithmetic(const bool t_const, const size_t t_tag, const size_t t_current, Types<T, Rest...>)
+                {
+                  if (t_tag != t_current) {
+                    return arithmetic(t_const, t_tag, t_current + 1, Types<Rest...>());
+                  }
+
+                  if (sizeof(T) > data.size() - pos) {
+                    throw std::out_of_range("Truncated constant in serialized AST");
+                  }
+
+                  T val;
+                  std::memcpy(&val, data.data() + pos, sizeof(T));
+                  pos += sizeof(T);
+                  return t_const ? const_var(val) : Boxed_Value(val);
+                }
+
+              Boxed_Value value()
+              {
+                const bool is_const = data.at(pos++) != '\0';
+                const auto tag = static_cast<size_t>(number());
+
+                switch (tag) {
+                  case string_tag:
+                    return is_const ? const_var(string()) : Boxed_Value(string());
+                  case placeholder_tag:
+                    return Boxed_Value(std::make_shared<dispatch::Placeholder_Object>());
+                  default:
+                    return arithmetic(is_const, tag, arithmetic_tag, Arithmetic_Types());
+                }
+              }
+
+              template<typename NodeType>
+                eval::AST_Node_Impl_Ptr<Tracer> make(std::string t_text, Parse_Location t_loc, std::vector<eval::AST_Node_Impl_Ptr<Tracer>> t_children) const
+                {
+                  return chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, NodeType>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                }
+
+              eval::AST_Node_Impl_Ptr<Tracer> make(const AST_Node_Type t_type, std::string t_text, Parse_Location t_loc,
+                  std::vector<eval::AST_Node_Impl_Ptr<Tracer>> t_children) const
+              {
+                switch (t_type) {
+                  case AST_Node_Type::Fun_Call: return make<eval::Fun_Call_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Arg: return make<eval::Arg_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Arg_List: return make<eval::Arg_List_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Equation: return make<eval::Equation_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Var_Decl: return make<eval::Var_Decl_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Array_Call: return make<eval::Array_Call_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Dot_Access: return make<eval::Dot_Access_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Lambda: return make<eval::Lambda_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Block: return make<eval::Block_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Scopeless_Block: return make<eval::Scopeless_Block_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Def: return make<eval::Def_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::While: return make<eval::While_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::If: return make<eval::If_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::For: return make<eval::For_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Ranged_For: return make<eval::Ranged_For_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Inline_Array: return make<eval::Inline_Array_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Inline_Map: return make<eval::Inline_Map_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Return: return make<eval::Return_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::File: return make<eval::File_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Prefix: return make<eval::Prefix_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Break: return make<eval::Break_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Continue: return make<eval::Continue_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Map_Pair: return make<eval::Map_Pair_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Value_Range: return make<eval::Value_Range_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Inline_Range: return make<eval::Inline_Range_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Try: return make<eval::Try_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Catch: return make<eval::Catch_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Finally: return make<eval::Finally_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Method: return make<eval::Method_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Attr_Decl: return make<eval::Attr_Decl_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Logical_And: return make<eval::Logical_And_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Logical_Or: return make<eval::Logical_Or_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Reference: return make<eval::Reference_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Switch: return make<eval::Switch_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Case: return make<eval::Case_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Default: return make<eval::Default_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Class: return make<eval::Class_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Binary: return make<eval::Binary_Operator_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  case AST_Node_Type::Global_Decl: return make<eval::Global_Decl_AST_Node<Tracer>>(std::move(t_text), std::move(t_loc), std::move(t_children));
+                  default:
+                    throw std::out_of_range("Unexpected node in serialized AST");
+                }
+              }
+
+              /// Reads a node and its children. The parser hands each node it builds from
+              /// children to the optimizer, except for the calls it moves into a Dot_Access
+              eval::AST_Node_Impl_Ptr<Tracer> node(const bool t_optimize)
+              {
+                const auto type = static_cast<AST_Node_Type>(number());
+                auto text = string();
+                auto loc = location();
+
+                switch (type) {
+                  case AST_Node_Type::Id:
+                    if (number() != 0) { throw std::out_of_range("Unexpected children in serialized AST"); }
+                    return chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Id_AST_Node<Tracer>>(text, std::move(loc));
+                  case AST_Node_Type::Constant: {
+                    auto val = value();
+                    if (number() != 0) { throw std::out_of_range("Unexpected children in serialized AST"); }
+                    return chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Constant_AST_Node<Tracer>>(std::move(text), std::move(loc), std::move(val));
+                  }
+                  case AST_Node_Type::Noop:
+                    if (number() != 0) { throw std::out_of_range("Unexpected children in serialized AST"); }
+                    return chaiscript::make_shared<eval::AST_Node_Impl<Tracer>, eval::Noop_AST_Node<Tracer>>();
+                  default:
+                    break;
+                }
+
+                const auto count = number();
+                std::vector<eval::AST_Node_Impl_Ptr<Tracer>> children;
+                for (uint64_t i = 0; i < count; ++i) {
+                  children.push_back(node(!(type == AST_Node_Type::Dot_Access && i == 1)));
+                }
+
+                auto result = make(type, std::move(text), std::move(loc), std::move(children));
+                if (t_optimize) {
+                  return optimizer.optimize(std::move(result));
+                } else {
+                  return result;
+                }
+              }
+            };
+      };
+    }
+  }
+}
+
+#endif /* CHAISCRIPT_SERIALIZER_HPP_ */
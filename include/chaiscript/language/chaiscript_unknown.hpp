@@ -8,10 +8,47 @@
 #define CHAISCRIPT_UNKNOWN_HPP_
 
 
+#include <fstream>
+#include <iterator>
+
 namespace chaiscript
 {
   namespace detail
   {
+    /// \returns t_filename, there is no way to resolve a path on this platform
+    inline std::string canonical_path(const std::string &t_filename)
+    {
+      return t_filename;
+    }
+
+    /// A script file read into memory, there is no way to map it on this platform
+    struct Mapped_File
+    {
+      explicit Mapped_File(const std::string &t_filename)
+      {
+        std::ifstream infile(t_filename.c_str(), std::ios::in | std::ios::binary);
+
+        if (!infile.is_open())
+        {
+          throw chaiscript::exception::file_not_found_error(t_filename);
+        }
+
+        m_contents.assign(std::istreambuf_iterator<char>(infile), std::istreambuf_iterator<char>());
+      }
+
+      const char *begin() const
+      {
+        return m_contents.data();
+      }
+
+      const char *end() const
+      {
+        return m_contents.data() + m_contents.size();
+      }
+
+      std::string m_contents;
+    };
+
     struct Loadable_Module
     {
       Loadable_Module(const std::string &, const std::string &)
@@ -127,6 +127,82 @@ namespace chaiscript
       DLSym<Create_Module_Func> m_func;
       ModulePtr m_moduleptr;
     };
+
+    /// \returns the absolute path of t_filename, or t_filename if it cannot be made absolute
+    inline std::string canonical_path(const std::string &t_filename)
+    {
+      char path[MAX_PATH];
+      const auto size = GetFullPathNameA(t_filename.c_str(), MAX_PATH, path, nullptr);
+      if (size == 0 || size >= MAX_PATH)
+      {
+        return t_filename;
+      }
+      return std::string(path, size);
+    }
+
+    /// A script file mapped into memory, so that it is parsed without being copied
+    struct Mapped_File
+    {
+      explicit Mapped_File(const std::string &t_filename)
+        : m_file(CreateFileA(t_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr))
+      {
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+          throw chaiscript::exception::file_not_found_error(t_filename);
+        }
+
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size))
+        {
+          CloseHandle(m_file);
+          throw chaiscript::exception::file_not_found_error(t_filename);
+        }
+
+        m_size = static_cast<size_t>(size.QuadPart);
+
+        // an empty file cannot be mapped
+        if (m_size > 0)
+        {
+          m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+          if (m_mapping)
+          {
+            m_data = static_cast<const char *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+          }
+
+          if (!m_data)
+          {
+            if (m_mapping) { CloseHandle(m_mapping); }
+            CloseHandle(m_file);
+            throw chaiscript::exception::file_not_found_error(t_filename);
+          }
+        }
+      }
+
+      Mapped_File(const Mapped_File &) = delete;
+      Mapped_File &operator=(const Mapped_File &) = delete;
+
+      ~Mapped_File()
+      {
+        if (m_data) { UnmapViewOfFile(m_data); }
+        if (m_mapping) { CloseHandle(m_mapping); }
+        CloseHandle(m_file);
+      }
+
+      const char *begin() const
+      {
+        return m_data;
+      }
+
+      const char *end() const
+      {
+        return m_data + m_size;
+      }
+
+      HANDLE m_file;
+      HANDLE m_mapping = nullptr;
+      const char *m_data = nullptr;
+      size_t m_size = 0;
+    };
   }
 }
 #endif 
@@ -31,6 +31,14 @@ namespace chaiscript
 #endif
     }
 
+    /// 64 bit hash of the bytes in [t_begin, t_end), which may include nulls
+    static inline std::uint64_t fnv1a_64(const char *t_begin, const char *t_end, std::uint64_t h = 0xcbf29ce484222325ULL) {
+      for (; t_begin != t_end; ++t_begin) {
+        h = (h ^ static_cast<unsigned char>(*t_begin)) * 0x100000001b3ULL;
+      }
+      return h;
+    }
+
 
   }
 
@@ -29,6 +29,21 @@
 
 #include <clocale>
 
+#ifndef CHAISCRIPT_NO_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+#ifdef _WIN32
+#include <direct.h>
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #include "catch.hpp"
 
 // lambda_tests
@@ -350,6 +365,154 @@ TEST_CASE("Functor cast")
   CHECK(d == 3 * 6);
 }
 
+TEST_CASE("Overloads are probed without throwing")
+{
+  chaiscript::Type_Conversions conversions;
+  chaiscript::Type_Conversions_State state(conversions, conversions.conversion_saves());
+
+  const chaiscript::Boxed_Value i(1);
+  const auto ci = chaiscript::const_var(2);
+  CHECK(chaiscript::can_boxed_cast<int>(i, &state));
+  CHECK(chaiscript::can_boxed_cast<int &>(i, &state));
+  CHECK(chaiscript::can_boxed_cast<const int &>(ci, &state));
+  CHECK_FALSE(chaiscript::can_boxed_cast<int &>(ci, &state));
+  CHECK_FALSE(chaiscript::can_boxed_cast<std::string>(i, &state));
+  CHECK(chaiscript::can_boxed_cast<chaiscript::Boxed_Number>(i, &state));
+  CHECK(chaiscript::can_boxed_cast<const chaiscript::Boxed_Value &>(i, &state));
+
+  const auto f = chaiscript::fun([](const std::string &s) { return s.size(); });
+  chaiscript::Boxed_Value result;
+  const std::array<chaiscript::Boxed_Value, 1> wrong_type{{i}};
+  CHECK_FALSE(f->try_call(chaiscript::Function_Params(wrong_type), state, result));
+  const std::array<chaiscript::Boxed_Value, 2> wrong_arity{{i, i}};
+  CHECK_FALSE(f->try_call(chaiscript::Function_Params(wrong_arity), state, result));
+  const std::array<chaiscript::Boxed_Value, 1> params{{chaiscript::var(std::string("abc"))}};
+  REQUIRE(f->try_call(chaiscript::Function_Params(params), state, result));
+  CHECK(chaiscript::boxed_cast<size_t>(result) == 3);
+}
+
+TEST_CASE("Functor callbacks dispatch on the types of each call")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.eval(R"(
+    def describe(int i) { return "int"; }
+    def describe(string s) { return "string"; }
+    def describe(x) { return "other"; }
+  )");
+
+  const auto describe = chai.eval<std::function<std::string (const chaiscript::Boxed_Value &)>>("describe");
+  const auto copy = describe;
+  for (int i = 0; i < 3; ++i) {
+    CHECK(describe(chaiscript::var(i)) == "int");
+    CHECK(copy(chaiscript::var(std::string("s"))) == "string");
+    CHECK(describe(chaiscript::var(1.5)) == "other");
+  }
+
+  // built without an engine's conversions
+  const auto scale = chaiscript::boxed_cast<std::function<int (int)>>(chai.eval("fun(i) { return i * 6; }"));
+  CHECK(scale(2) == 12);
+  CHECK(scale(3) == 18);
+}
+
+TEST_CASE("Dynamic_Object attributes are read through their shape")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.eval(R"(
+    class Point {
+      attr x;
+      attr y;
+      def Point(t_x, t_y) { this.x = t_x; this.y = t_y; }
+    }
+    class Size {
+      attr y;
+      attr x;
+      def Size(t_x, t_y) { this.y = t_y; this.x = t_x; }
+    }
+    def sum_x(objs) { var s = 0; for (var i = 0; i < objs.size(); ++i) { s += objs[i].x; } return s; }
+  )");
+
+  // objects of both classes pass through the same access site
+  CHECK(chai.eval<int>("sum_x([Point(1, 2), Size(10, 20), Point(100, 200), Size(1000, 2000)])") == 1111);
+  CHECK(chai.eval<int>("var p = Point(3, 4); p.x = 5; p.x + p.y") == 9);
+
+  const auto p1 = chai.eval("Point(1, 2)");
+  const auto p2 = chai.eval("Point(5, 6)");
+  const auto s1 = chai.eval("Size(1, 2)");
+  const auto &p = chaiscript::boxed_cast<const chaiscript::dispatch::Dynamic_Object &>(p1);
+  const auto &s = chaiscript::boxed_cast<const chaiscript::dispatch::Dynamic_Object &>(s1);
+  CHECK(p.get_shape().find("x") == 0);
+  CHECK(s.get_shape().find("x") == 1);
+  CHECK(&p.get_shape() == &chaiscript::boxed_cast<const chaiscript::dispatch::Dynamic_Object &>(p2).get_shape());
+  REQUIRE(p.get_attrs().size() == 2);
+  CHECK(chaiscript::boxed_cast<int>(p.get_attrs().at("y")) == 2);
+}
+
+TEST_CASE("Script methods are matched on the identity of their class")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.eval(R"(
+    class Cat { def Cat() {} def speak() { "meow" } }
+    class Dog { def Dog() {} def speak() { "woof" } }
+    def Dynamic_Object::kind() { "object" }
+  )");
+
+  CHECK(chai.eval<std::string>("Cat().speak()") == "meow");
+  CHECK(chai.eval<std::string>("Dog().speak()") == "woof");
+  CHECK(chai.eval<std::string>("Dog().kind()") == "object");
+  // an object created by name belongs to the same class
+  CHECK(chai.eval<std::string>("Dynamic_Object(\"Cat\").speak()") == "meow");
+
+  const auto cat = chai.eval("Cat()");
+  const auto &d = chaiscript::boxed_cast<const chaiscript::dispatch::Dynamic_Object &>(cat);
+  CHECK(d.get_shape().class_id() == chaiscript::dispatch::Object_Shape::root("Cat").get());
+}
+
+TEST_CASE("Objects with many attributes keep the ones past the shape limit in a dictionary")
+{
+  using chaiscript::dispatch::Object_Shape;
+
+  chaiscript::dispatch::Dynamic_Object obj("Wide");
+  for (int i = 0; i < 5000; ++i) {
+    obj["attr" + std::to_string(i)] = chaiscript::Boxed_Value(i);
+  }
+
+  const size_t max_size = Object_Shape::max_size;
+  CHECK(obj.get_shape().size() == max_size);
+  REQUIRE(obj.get_attrs().size() == 5000);
+  CHECK(chaiscript::boxed_cast<int>(obj.get_attr("attr0")) == 0);
+  CHECK(chaiscript::boxed_cast<int>(obj.get_attr("attr4999")) == 4999);
+  CHECK(obj.has_attr("attr100"));
+  CHECK_FALSE(obj.has_attr("attr5000"));
+
+  // a class with too many different successors of a shape
+  for (size_t i = 0; i < Object_Shape::max_transitions + 10; ++i) {
+    chaiscript::dispatch::Dynamic_Object branch("Branching");
+    branch["first"] = chaiscript::Boxed_Value(1);
+    branch["second" + std::to_string(i)] = chaiscript::Boxed_Value(2);
+    CHECK(branch.get_attrs().size() == 2);
+  }
+}
+
+TEST_CASE("Shapes are freed when no object uses them")
+{
+  std::weak_ptr<const chaiscript::dispatch::Object_Shape> shape;
+  std::weak_ptr<const chaiscript::dispatch::Object_Shape> root;
+
+  {
+    chaiscript::dispatch::Dynamic_Object obj("Short_Lived");
+    obj["x"] = chaiscript::Boxed_Value(1);
+    shape = obj.get_shared_shape();
+    root = chaiscript::dispatch::Object_Shape::root("Short_Lived");
+    CHECK(shape.lock()->find("x") == 0);
+  }
+
+  CHECK(shape.expired());
+  CHECK(root.expired());
+}
+
 
 
 int set_state_test_myfun()
@@ -391,6 +554,28 @@ TEST_CASE("Set and restore chai state")
   CHECK_THROWS_AS(chai.eval<int>("i"), chaiscript::exception::eval_error &);
 }
 
+TEST_CASE("State snapshots share what has not changed")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  const auto first = chai.get_state();
+  const auto second = chai.get_state();
+  CHECK(first.engine_state.m_registry == second.engine_state.m_registry);
+  CHECK(first.engine_state.m_types == second.engine_state.m_types);
+  CHECK(first.used_files == second.used_files);
+
+  chai.add(chaiscript::fun(&set_state_test_myfun), "myfun");
+  const auto changed = chai.get_state();
+  CHECK(changed.engine_state.m_registry != first.engine_state.m_registry);
+  CHECK(changed.engine_state.m_types == first.engine_state.m_types);
+  CHECK(first.engine_state.m_registry->functions.find("myfun") == first.engine_state.m_registry->functions.size());
+
+  chai.set_state(first);
+  CHECK_THROWS(chai.eval("myfun()"));
+  chai.set_state(changed);
+  CHECK(chai.eval<int>("myfun()") == 2);
+}
+
 
 //// Short comparisons
 
@@ -426,6 +611,24 @@ class Type_Name_MyClass
 {
 };
 
+TEST_CASE("Dynamic functions and calls still accept parameters as a std::vector")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  chai.add(chaiscript::dispatch::make_dynamic_proxy_function(
+        [](const std::vector<chaiscript::Boxed_Value> &t_params) {
+          return chaiscript::Boxed_Value(static_cast<int>(t_params.size()));
+        }), "count_params");
+  CHECK(chai.eval<int>("count_params(1, \"two\", 3.0)") == 3);
+
+  const auto add = chai.eval<chaiscript::Proxy_Function>("fun(x, y) { x + y }");
+  const std::vector<chaiscript::Boxed_Value> params{chaiscript::var(2), chaiscript::var(3)};
+  chaiscript::Type_Conversions conversions;
+  chaiscript::Type_Conversions_State state(conversions, conversions.conversion_saves());
+  CHECK(add->call_match(params, state));
+  CHECK(chaiscript::boxed_cast<int>((*add)(params, state)) == 5);
+}
+
 TEST_CASE("Test lookup of type names")
 {
   chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
@@ -472,6 +675,69 @@ TEST_CASE("Simultaneous ChaiScript tests")
   }
 }
 
+TEST_CASE("Thread_Storage state is not inherited by a later owner")
+{
+  for (int i = 0; i < 3; ++i)
+  {
+    chaiscript::detail::threading::Thread_Storage<int> first(nullptr);
+    chaiscript::detail::threading::Thread_Storage<int> second(nullptr);
+    CHECK(*first == 0);
+    CHECK(*second == 0);
+    *first = 1;
+    *second = 2;
+    CHECK(*first == 1);
+    CHECK(*second == 2);
+  }
+}
+
+#ifndef CHAISCRIPT_NO_THREADS
+std::atomic<int> thread_storage_values_destroyed{0};
+
+struct Thread_Storage_Value
+{
+  ~Thread_Storage_Value() { ++thread_storage_values_destroyed; }
+};
+
+TEST_CASE("Thread_Storage frees the values of other threads when it is destroyed")
+{
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool used = false;
+  bool done = false;
+
+  auto storage = std::make_unique<chaiscript::detail::threading::Thread_Storage<Thread_Storage_Value>>(nullptr);
+  std::thread thread([&]() {
+      **storage;
+      {
+        std::lock_guard<std::mutex> l(mutex);
+        used = true;
+      }
+      cv.notify_all();
+
+      std::unique_lock<std::mutex> l(mutex);
+      cv.wait(l, [&]() { return done; });
+    });
+
+  {
+    std::unique_lock<std::mutex> l(mutex);
+    cv.wait(l, [&]() { return used; });
+  }
+
+  // the thread is still running
+  const auto destroyed = thread_storage_values_destroyed.load();
+  storage.reset();
+  CHECK(thread_storage_values_destroyed == destroyed + 1);
+
+  {
+    std::lock_guard<std::mutex> l(mutex);
+    done = true;
+  }
+  cv.notify_all();
+  thread.join();
+  CHECK(thread_storage_values_destroyed == destroyed + 1);
+}
+#endif
+
 
 
 /////////////// test utility functions
@@ -785,6 +1051,87 @@ TEST_CASE("Object lifetime test 2")
 }
 
 
+///////////////////// Long running loops keep a steady number of temporaries
+
+TEST_CASE("Loop temporaries are released while the loop runs")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::user_type<Object_Lifetime_Test>(), "Object_Lifetime_Test");
+  chai.add(chaiscript::constructor<Object_Lifetime_Test()>(), "Object_Lifetime_Test");
+  chai.add(chaiscript::fun(&Object_Lifetime_Test::count), "count");
+  chai.add(chaiscript::fun([](const Object_Lifetime_Test &) { return 1; }), "consume");
+
+  chai.eval(R"(
+    global most = 0;
+    def track() { if (count() > most) { most = count(); } }
+    def while_loop() { var i = 0; while (i < 100) { i += consume(Object_Lifetime_Test()); track(); } }
+    def for_loop() { var n = 0; for (var i = 0; i < 100; ++i) { n += consume(Object_Lifetime_Test()); track(); } }
+    def ranged_for() { var n = 0; for (x : [1, 2, 3, 4, 5, 6, 7, 8, 9, 10]) { n += consume(Object_Lifetime_Test()); track(); } }
+    )");
+
+  // only the temporaries of the current iteration may be alive
+  chai.eval("while_loop()");
+  CHECK(chai.eval<int>("most") == 1);
+  chai.eval("for_loop()");
+  CHECK(chai.eval<int>("most") == 1);
+  chai.eval("ranged_for()");
+  CHECK(chai.eval<int>("most") == 1);
+  CHECK(chai.eval<int>("count()") == 0);
+}
+
+struct Loop_Holder
+{
+  std::string text;
+};
+
+TEST_CASE("Loop temporaries a reference was bound into are kept")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::fun([](const std::string &t_text) { return Loop_Holder{t_text}; }), "make_holder");
+  chai.add(chaiscript::fun([](Loop_Holder &t_holder) -> std::string & { return t_holder.text; }), "text");
+
+  chai.eval(R"(
+    global seen = "";
+    def f() {
+      var r;
+      var i = 0;
+      while (i < 3) {
+        if (i > 0) { seen += "prev: " + r + ";"; }
+        r := text(make_holder("value" + to_string(i)));
+        ++i;
+      }
+    }
+    f();
+    )");
+
+  CHECK(chai.eval<std::string>("seen") == "prev: value0;prev: value1;");
+}
+
+
+///////////////////// Values stored inline in their Boxed_Value
+
+TEST_CASE("Values stored inline keep their sharing semantics")
+{
+  std::shared_ptr<int> shared;
+  {
+    chaiscript::Boxed_Value bv = chaiscript::var(3);
+    shared = chaiscript::boxed_cast<std::shared_ptr<int>>(bv);
+    *shared = 4;
+    CHECK(chaiscript::boxed_cast<int>(bv) == 4);
+  }
+  CHECK(*shared == 4);
+
+  chaiscript::Boxed_Value number = chaiscript::const_var(5);
+  CHECK(number.is_const());
+  CHECK(*chaiscript::boxed_cast<std::shared_ptr<const int>>(number) == 5);
+  CHECK_THROWS_AS(chaiscript::boxed_cast<std::shared_ptr<int>>(number), chaiscript::exception::bad_boxed_cast &);
+
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  CHECK(chai.eval<int>("var i = 1; auto &r = i; r = 6; i") == 6);
+  CHECK(chai.eval<std::string>("var s = \"abc\"; auto &t = s; t += \"d\"; s") == "abcd");
+}
+
+
 
 
 ///// Non-polymorphic base class conversions
@@ -806,6 +1153,38 @@ TEST_CASE("Test Derived->Base with non-polymorphic classes")
 }
 
 
+///// Conversions through intermediate base classes
+class Chain_Base
+{
+  public:
+    virtual ~Chain_Base() = default;
+    int base_value() const { return 1; }
+};
+
+class Chain_Middle : public Chain_Base {};
+
+class Chain_Derived : public Chain_Middle
+{
+  public:
+    int derived_value() const { return 3; }
+};
+
+TEST_CASE("Conversions are chained through intermediate base classes")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  chai.add(chaiscript::base_class<Chain_Base, Chain_Middle>());
+  chai.add(chaiscript::base_class<Chain_Middle, Chain_Derived>());
+  chai.add(chaiscript::fun(&Chain_Base::base_value), "base_value");
+  chai.add(chaiscript::fun(&Chain_Derived::derived_value), "derived_value");
+  chai.add(chaiscript::fun([]() -> std::shared_ptr<Chain_Base> { return std::make_shared<Chain_Derived>(); }), "make_chain_base");
+  chai.add(chaiscript::var(std::make_shared<Chain_Derived>()), "d");
+
+  CHECK(chai.eval<int>("d.base_value()") == 1);
+  CHECK(chai.eval<int>("make_chain_base().derived_value()") == 3);
+  CHECK(chai.eval<const Chain_Base &>("d").base_value() == 1);
+}
+
+
 struct TestCppVariableScope
 {
   void print()
@@ -988,6 +1367,355 @@ TEST_CASE("Make sure ChaiScript object still compiles / executes")
   chaiscript::ChaiScript chai;
 }
 
+TEST_CASE("Engines started from the same library image are independent")
+{
+  const auto image = std::make_shared<const chaiscript::Library_Image>(create_chaiscript_stdlib(), *create_chaiscript_parser());
+  chaiscript::ChaiScript_Basic chai1(image, create_chaiscript_parser());
+  chaiscript::ChaiScript_Basic chai2(image, create_chaiscript_parser());
+
+  chai1.eval("def twice(x) { x * 2 }");
+  chai2.eval("def twice(x) { x * 3 }");
+  chai1.add(chaiscript::fun([](int i) { return i + 1; }), "next");
+
+  // prelude functions call back into the engine they were evaluated in
+  CHECK(chai1.eval<double>("sum(map([1, 2, 3], twice))") == 12);
+  CHECK(chai2.eval<double>("sum(map([1, 2, 3], twice))") == 18);
+  CHECK(chai1.eval<int>("next(1)") == 2);
+  CHECK_THROWS(chai2.eval("next(1)"));
+  CHECK(chai2.eval<std::string>("to_string([1, 2])") == "[1, 2]");
+
+  CHECK(chaiscript::ChaiScript::standard_library() == chaiscript::ChaiScript::standard_library());
+}
+
+TEST_CASE("Forked engines share their parent's definitions but not their changes")
+{
+  chaiscript::ChaiScript_Basic parent(create_chaiscript_stdlib(),create_chaiscript_parser());
+  parent.eval(R"(
+    global counter = 0;
+    def handler(x) { "parent " + to_string(x) }
+    def process(x) { ++counter; handler(x) }
+    class Box { attr value; def Box(v) { this.value = v; } def get() { this.value } }
+  )");
+
+  chaiscript::ChaiScript_Basic child1(parent, create_chaiscript_parser());
+  chaiscript::ChaiScript_Basic child2(parent, create_chaiscript_parser());
+
+  // the parent's script functions see the definitions of the fork calling them
+  child1.eval("def handler(int x) { \"child \" + to_string(x) }");
+  CHECK(child1.eval<std::string>("process(1)") == "child 1");
+  CHECK(child2.eval<std::string>("process(2)") == "parent 2");
+  CHECK(parent.eval<std::string>("process(3)") == "parent 3");
+  CHECK(child1.eval<int>("Box(4).get()") == 4);
+
+  // globals are cloned for each fork
+  CHECK(child1.eval<int>("counter") == 1);
+  CHECK(child2.eval<int>("counter") == 1);
+  CHECK(parent.eval<int>("counter") == 1);
+
+  // eval and the other engine functions belong to the fork
+  child2.eval("eval(\"def only_in_child2() { 5 }\")");
+  CHECK(child2.eval<int>("only_in_child2()") == 5);
+  CHECK_THROWS(parent.eval("only_in_child2()"));
+  CHECK_THROWS(child1.eval("only_in_child2()"));
+
+  chaiscript::ChaiScript_Basic grandchild(child1, create_chaiscript_parser());
+  CHECK(grandchild.eval<std::string>("process(6)") == "child 6");
+}
+
+struct Fork_Global
+{
+  int value;
+};
+
+TEST_CASE("Forks copy a global the first time they use it")
+{
+  int clones = 0;
+  chaiscript::ChaiScript_Basic parent(create_chaiscript_stdlib(),create_chaiscript_parser());
+  parent.add(chaiscript::user_type<Fork_Global>(), "Fork_Global");
+  parent.add(chaiscript::fun(&Fork_Global::value), "value");
+  parent.add(chaiscript::fun([&clones](const Fork_Global &t_global) { ++clones; return t_global; }), "clone");
+  parent.add_global(chaiscript::var(Fork_Global{1}), "first");
+  parent.add_global(chaiscript::var(Fork_Global{2}), "second");
+  parent.add_global(chaiscript::var(Fork_Global{3}), "third");
+
+  chaiscript::ChaiScript_Basic child(parent, create_chaiscript_parser());
+  CHECK(clones == 0);
+
+  child.eval("first.value = 10");
+  CHECK(child.eval<int>("first.value") == 10);
+  CHECK(parent.eval<int>("first.value") == 1);
+  CHECK(clones == 1);
+
+  // until then the fork sees the parent's changes
+  parent.eval("second.value = 20");
+  CHECK(child.eval<int>("second.value") == 20);
+  child.eval("second.value = 21");
+  CHECK(parent.eval<int>("second.value") == 20);
+  CHECK(clones == 2);
+
+  child.set_global(chaiscript::var(Fork_Global{30}), "third");
+  CHECK(child.eval<int>("third.value") == 30);
+  CHECK(parent.eval<int>("third.value") == 3);
+  CHECK(clones == 3);
+}
+
+TEST_CASE("Script functions outlive the engine they were defined in while a fork remains")
+{
+  auto parent = std::make_unique<chaiscript::ChaiScript_Basic>(create_chaiscript_stdlib(),create_chaiscript_parser());
+  parent->eval("def triple(x) { x * 3 }");
+
+  auto child = std::make_unique<chaiscript::ChaiScript_Basic>(*parent, create_chaiscript_parser());
+  // cast without the engine's conversions, nothing tells the call which engine to use
+  const auto triple = chaiscript::boxed_cast<std::function<int (int)>>(child->eval("triple"));
+  CHECK(triple(2) == 6);
+
+  parent.reset();
+  CHECK(triple(3) == 9);
+  CHECK(child->eval<int>("triple(4)") == 12);
+
+  // an engine that is not of the family does not take the family's place
+  chaiscript::ChaiScript_Basic stranger(create_chaiscript_stdlib(),create_chaiscript_parser());
+  child.reset();
+  CHECK_THROWS_AS(triple(5), chaiscript::exception::eval_error &);
+}
+
+TEST_CASE("Inline caches replace stale entries and keep caching past their size")
+{
+  typedef std::pair<int, std::weak_ptr<int>> Entry;
+  chaiscript::detail::Inline_Cache<Entry> cache;
+  const auto find = [&cache](const int t_key) {
+    return cache.find([t_key](const Entry &t_entry) { return t_entry.first == t_key ? t_entry.first : 0; });
+  };
+  const auto stale = [](const Entry &t_entry) { return t_entry.second.expired(); };
+
+  std::vector<std::shared_ptr<int>> values;
+  for (int key = 1; key <= 20; ++key) {
+    values.push_back(std::make_shared<int>(key));
+    cache.add(std::make_unique<const Entry>(key, values.back()), stale);
+    CHECK(find(key) == key);
+  }
+
+  // the oldest entries made room
+  CHECK(find(16) == 0);
+  CHECK(find(17) == 17);
+
+  // a stale entry is replaced before the oldest
+  values[18].reset();
+  values.push_back(std::make_shared<int>(21));
+  cache.add(std::make_unique<const Entry>(21, values.back()), stale);
+  CHECK(find(21) == 21);
+  CHECK(find(19) == 0);
+  CHECK(find(17) == 17);
+}
+
+/// A directory that is removed, with the files in it, when it goes out of scope
+struct Temp_Directory
+{
+  Temp_Directory()
+    : path("chaiscript_test_" + std::to_string(std::random_device()()))
+  {
+#ifdef _WIN32
+    REQUIRE(_mkdir(path.c_str()) == 0);
+#else
+    REQUIRE(mkdir(path.c_str(), 0700) == 0);
+#endif
+  }
+
+  ~Temp_Directory()
+  {
+    for (const auto &file : files()) {
+      std::remove((path + '/' + file).c_str());
+    }
+#ifdef _WIN32
+    _rmdir(path.c_str());
+#else
+    rmdir(path.c_str());
+#endif
+  }
+
+  /// \returns the names of the files in the directory
+  std::vector<std::string> files() const
+  {
+    std::vector<std::string> names;
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    const auto find = FindFirstFileA((path + "/*").c_str(), &entry);
+    if (find != INVALID_HANDLE_VALUE) {
+      do {
+        if (!(entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)) {
+          names.push_back(entry.cFileName);
+        }
+      } while (FindNextFileA(find, &entry));
+      FindClose(find);
+    }
+#else
+    if (const auto dir = opendir(path.c_str())) {
+      while (const auto entry = readdir(dir)) {
+        const std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+          names.push_back(name);
+        }
+      }
+      closedir(dir);
+    }
+#endif
+    return names;
+  }
+
+  Temp_Directory(const Temp_Directory &) = delete;
+  Temp_Directory &operator=(const Temp_Directory &) = delete;
+
+  std::string path;
+};
+
+/// Counts the files that had to be parsed and the trees that were read back,
+/// character ranges are parsed by the default, which goes through parse(std::string)
+struct Counting_Parser : chaiscript::parser::ChaiScript_Parser_Base
+{
+  using chaiscript::parser::ChaiScript_Parser_Base::parse;
+
+  chaiscript::AST_NodePtr parse(const std::string &t_input, const std::string &t_fname) override
+  {
+    ++parsed;
+    return m_parser->parse(t_input, t_fname);
+  }
+
+  void debug_print(chaiscript::AST_NodePtr t, std::string prepend = "") const override
+  {
+    m_parser->debug_print(std::move(t), std::move(prepend));
+  }
+
+  void *get_tracer_ptr() override
+  {
+    return m_parser->get_tracer_ptr();
+  }
+
+  bool save(const chaiscript::AST_NodePtr &t_ast, std::string &t_data) const override
+  {
+    return m_parser->save(t_ast, t_data);
+  }
+
+  chaiscript::AST_NodePtr load(const std::string &t_data) override
+  {
+    auto ast = m_parser->load(t_data);
+    if (ast) {
+      ++loaded;
+    }
+    return ast;
+  }
+
+  int parsed = 0;
+  int loaded = 0;
+
+  private:
+    std::unique_ptr<chaiscript::parser::ChaiScript_Parser_Base> m_parser = create_chaiscript_parser();
+};
+
+TEST_CASE("Parsed trees survive being saved and loaded")
+{
+  const std::string script = R"(
+    class Counter {
+      attr n;
+      def Counter() { this.n = 0; }
+      def bump() { ++this.n; }
+      def double(x) { x * 3 }
+    }
+    def scale(x) { x * (2 + 3) }
+    var c = Counter();
+    for (var i = 0; i < 10; ++i) { c.bump(); }
+    var total = 0;
+    for (i : [1, 2, 3]) { total += scale(i); }
+    "${c.n} ${total} ${c.double(2)} ${-7 % 3} ${true && false} " + __FILE__
+  )";
+
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+  const auto ast = chai.get_parser().parse(script, "saved.chai");
+  std::string data;
+  REQUIRE(chai.get_parser().save(ast, data));
+
+  const auto loaded = chai.get_parser().load(data);
+  REQUIRE(loaded);
+  CHECK(chai.boxed_cast<std::string>(chai.eval(loaded)) == "10 30 6 -1 false saved.chai");
+
+  CHECK_FALSE(chai.get_parser().load(data.substr(0, data.size() - 1)));
+  CHECK_FALSE(chai.get_parser().load("not a tree"));
+
+  // files given to eval_file are read back from the cache by other engines
+  Temp_Directory directory;
+  const std::string filename = directory.path + "/ast_cache_test.chai";
+  {
+    std::ofstream file(filename.c_str());
+    file << "def area(w, h) { w * h }\narea(3, 4) + 1";
+  }
+
+  auto writer_parser = std::make_unique<Counting_Parser>();
+  auto &writer_counts = *writer_parser;
+  chaiscript::ChaiScript_Basic writer(create_chaiscript_stdlib(), std::move(writer_parser));
+  writer.set_ast_cache_directory(directory.path);
+  const auto writer_prelude = writer_counts.parsed;
+  CHECK(writer.eval_file<int>(filename) == 13);
+  CHECK(writer_counts.parsed == writer_prelude + 1);
+  CHECK(writer_counts.loaded == 0);
+
+  auto reader_parser = std::make_unique<Counting_Parser>();
+  auto &reader_counts = *reader_parser;
+  chaiscript::ChaiScript_Basic reader(create_chaiscript_stdlib(), std::move(reader_parser));
+  reader.set_ast_cache_directory(directory.path);
+  const auto reader_prelude = reader_counts.parsed;
+  CHECK(reader.eval_file<int>(filename) == 13);
+  CHECK(reader_counts.parsed == reader_prelude);
+  CHECK(reader_counts.loaded == 1);
+  CHECK(reader.eval<int>("area(2, 2)") == 4);
+
+  {
+    std::ofstream file(filename.c_str());
+    file << "area(3, 4) + 2";
+  }
+  CHECK(reader.eval_file<int>(filename) == 14);
+  CHECK(reader_counts.parsed == reader_prelude + 2);
+  CHECK(reader_counts.loaded == 1);
+
+  // the edited file's tree replaced the one kept before
+  CHECK(directory.files().size() == 2);
+  CHECK(reader.eval_file<int>(filename) == 14);
+  CHECK(reader_counts.loaded == 2);
+}
+
+TEST_CASE("Scripts are parsed from a character range and from mapped files")
+{
+  chaiscript::ChaiScript_Basic chai(create_chaiscript_stdlib(),create_chaiscript_parser());
+
+  // the range does not need to be terminated, nothing past its end is read
+  const char buffer[] = {'4', ' ', '*', ' ', '5', '5', ';'};
+  const auto ast = chai.get_parser().parse(buffer, buffer + 5, "range");
+  CHECK(chai.boxed_cast<int>(chai.eval(ast)) == 20);
+
+  // parsers that only parse strings get the range as a string
+  Counting_Parser counting;
+  CHECK(chai.boxed_cast<int>(chai.eval(counting.parse(buffer, buffer + 5, "range"))) == 20);
+  CHECK(counting.parsed == 1);
+
+  Temp_Directory directory;
+  const std::string filename = directory.path + "/mapped_file_test.chai";
+  {
+    std::ofstream file(filename.c_str());
+    file << "var table = [";
+    for (int i = 0; i < 10000; ++i) {
+      file << i << ", ";
+    }
+    file << "10000]\ntable.size()";
+  }
+  CHECK(chai.eval_file<size_t>(filename) == 10001);
+
+  {
+    std::ofstream file(filename.c_str(), std::ios::trunc);
+  }
+  CHECK_NOTHROW(chai.eval_file(filename));
+
+  std::remove(filename.c_str());
+  CHECK_THROWS_AS(chai.eval_file(filename), chaiscript::exception::file_not_found_error &);
+}
+
 struct Count_Tracer
 {
   int count = 0;
@@ -1016,6 +1744,45 @@ TEST_CASE("Test count tracer")
 }
 
 
+TEST_CASE("Operator expressions are lowered once, where a statement uses them")
+{
+  typedef chaiscript::eval::Noop_Tracer Tracer;
+  typedef chaiscript::eval::AST_Node_Impl_Ptr<Tracer> Node_Ptr;
+  chaiscript::parser::ChaiScript_Parser<Tracer, chaiscript::optimizer::Optimizer_Default> parser;
+
+  const auto parse = [&parser](const std::string &t_script) {
+    return std::dynamic_pointer_cast<chaiscript::eval::AST_Node_Impl<Tracer>>(parser.parse(t_script, "lowered"));
+  };
+
+  std::function<Node_Ptr (const Node_Ptr &, chaiscript::AST_Node_Type)> find
+    = [&find](const Node_Ptr &t_node, const chaiscript::AST_Node_Type t_type) -> Node_Ptr {
+      const auto &node = chaiscript::optimizer::original_node(t_node);
+      if (node->identifier == t_type) {
+        return t_node;
+      }
+      for (const auto &child : node->children) {
+        if (auto found = find(child, t_type)) {
+          return found;
+        }
+      }
+      return nullptr;
+    };
+
+  // an expression in a function body is one program, its operands stay operators
+  const auto equation = find(parse("def f(a, b) { var x = a * b + a - b; x }"), chaiscript::AST_Node_Type::Equation);
+  REQUIRE(equation);
+  const auto expression = equation->children[1];
+  REQUIRE(expression->identifier == chaiscript::AST_Node_Type::Compiled);
+  REQUIRE(expression->children.size() == 2);
+  CHECK(expression->children[0]->identifier == chaiscript::AST_Node_Type::Binary);
+  CHECK(expression->children[0]->children[0]->identifier == chaiscript::AST_Node_Type::Binary);
+
+  // the counted loop still sees the operators of its condition
+  const auto loop = find(parse("var n = 10; for (var i = 0; i < n - 1; ++i) { }"), chaiscript::AST_Node_Type::For);
+  REQUIRE(loop);
+  CHECK(loop->identifier == chaiscript::AST_Node_Type::Compiled);
+}
+
 TEST_CASE("Test stdlib options")
 {
   const auto test_has_external_scripts = [](chaiscript::ChaiScript_Basic &chai) { 
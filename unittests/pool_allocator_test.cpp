@@ -0,0 +1,89 @@
+// Tests the pool allocator used when CHAISCRIPT_POOL_ALLOCATOR is defined
+
+#ifdef __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunknown-pragmas"
+#pragma GCC diagnostic ignored "-Wparentheses"
+#endif
+
+#ifndef CHAISCRIPT_POOL_ALLOCATOR
+#define CHAISCRIPT_POOL_ALLOCATOR
+#endif
+
+#include <chaiscript/chaiscript_defines.hpp>
+#include <chaiscript/dispatchkit/boxed_value.hpp>
+#include <chaiscript/dispatchkit/boxed_cast.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+#define CATCH_CONFIG_MAIN
+
+#include "catch.hpp"
+
+
+TEST_CASE("Boxed_Value data is allocated from the pool")
+{
+  const auto before = chaiscript::pool_statistics();
+
+  {
+    std::vector<chaiscript::Boxed_Value> values;
+    for (int i = 0; i < 1000; ++i) {
+      values.emplace_back(i);
+      values.emplace_back(std::to_string(i));
+    }
+    CHECK(chaiscript::boxed_cast<int>(values[10]) == 5);
+    CHECK(chaiscript::boxed_cast<std::string>(values[11]) == "5");
+  }
+
+  const auto after = chaiscript::pool_statistics();
+  CHECK(after.allocations >= before.allocations + 2000);
+  CHECK(after.allocations - before.allocations == after.deallocations - before.deallocations);
+  CHECK(after.slabs >= 1);
+  CHECK(after.bytes_reserved == after.slabs * chaiscript::detail::Pool::slab_size);
+}
+
+TEST_CASE("Freed pool blocks are reused")
+{
+  { chaiscript::Boxed_Value warm(1); }
+  const auto slabs = chaiscript::pool_statistics().slabs;
+  for (int i = 0; i < 10000; ++i) {
+    chaiscript::Boxed_Value bv(i);
+  }
+  CHECK(chaiscript::pool_statistics().slabs == slabs);
+}
+
+TEST_CASE("Pool blocks can be freed by another thread")
+{
+  std::vector<chaiscript::Boxed_Value> values;
+  std::thread producer([&values]() {
+      for (int i = 0; i < 20000; ++i) {
+        values.emplace_back(i);
+      }
+    });
+  producer.join();
+
+  const auto before = chaiscript::pool_statistics();
+  CHECK(chaiscript::boxed_cast<int>(values.back()) == 19999);
+  values.clear();
+  const auto after = chaiscript::pool_statistics();
+
+  // the producer's counters were retired when it exited, the frees are counted here
+  CHECK(after.deallocations >= before.deallocations + 20000);
+}
+
+TEST_CASE("Objects too large for the pool are passed on to operator new")
+{
+  struct Large
+  {
+    char data[1024];
+  };
+
+  const auto before = chaiscript::pool_statistics();
+  {
+    chaiscript::Boxed_Value bv{Large()};
+    CHECK(bv.get_type_info() == chaiscript::user_type<Large>());
+  }
+  CHECK(chaiscript::pool_statistics().oversized > before.oversized);
+}
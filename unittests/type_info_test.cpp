@@ -52,3 +52,39 @@ TEST_CASE("Type_Info objects generate expected results")
 
 
 
+
+TEST_CASE("Type_Info objects compare by interned type ids")
+{
+  const auto i = chaiscript::user_type<int>();
+  CHECK(i.bare_id() != 0);
+  CHECK(i.bare_id() == chaiscript::user_type<const int &>().bare_id());
+  CHECK(i.bare_id() == chaiscript::user_type<std::shared_ptr<int>>().bare_id());
+  CHECK(i.bare_id() != chaiscript::user_type<double>().bare_id());
+  CHECK(chaiscript::Type_Info().bare_id() == 0);
+
+  CHECK(i == chaiscript::user_type<const int>());
+  CHECK(i.bare_equal(chaiscript::user_type<int *>()));
+  CHECK_FALSE(i == chaiscript::user_type<int *>());
+
+  // as created by code that does not share the ids, such as another shared library
+  const chaiscript::Type_Info foreign(false, false, false, false, true, &typeid(int), &typeid(int));
+  CHECK(foreign == i);
+  CHECK(foreign.bare_equal(i));
+  CHECK_FALSE(foreign.bare_equal(chaiscript::user_type<double>()));
+  CHECK(foreign.bare_id() == i.bare_id());
+
+  const chaiscript::Type_Info foreign_double(false, false, false, false, true, &typeid(double), &typeid(double));
+  CHECK_FALSE(foreign == foreign_double);
+  CHECK_FALSE(foreign.bare_equal(foreign_double));
+  CHECK_FALSE(chaiscript::Type_Info() == i);
+  CHECK_FALSE(chaiscript::Type_Info() == foreign);
+}
+
+TEST_CASE("Type_Info objects are created at compile time")
+{
+  constexpr auto i = chaiscript::user_type<int>();
+  static_assert(i == chaiscript::user_type<const int &>(), "int and const int & have the same type_info");
+  static_assert(i.bare_equal(chaiscript::user_type<int *>()), "int * is a pointer to an int");
+  static_assert(!(i == chaiscript::user_type<double>()), "int is not a double");
+  CHECK(i.bare_id() == chaiscript::user_type<int *>().bare_id());
+}